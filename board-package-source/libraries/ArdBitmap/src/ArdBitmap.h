@@ -22,10 +22,13 @@
 //Uncomment NO_SPEED_HACK if speed is not important (reduce ~100 bytes)
 //#define NO_SPEED_HACK
 
-//Uncomment RESIZE_HACK for fast drawResized with resize >= 1.0
+//Uncomment RESIZE_HACK for fast drawResized with resize >= 1.0 (drawn at
+//the original size, uncompressed bitmaps aren't enlarged)
 //#define RESIZE_HACK
 
 #include <Arduino.h>
+#include <FixedPoints.h>
+#include <FixedPointsCommon.h>
 
 #define ALIGN_H_LEFT    0b00000000
 #define ALIGN_H_RIGHT   0b00000001
@@ -52,6 +55,18 @@ static const uint8_t BIT_SHIFT[8] = {
   0b10000000,
 };
 
+// Sine of the first quarter turn, 64 steps, 8 fraction bits (max 255)
+static const uint8_t SIN_QUARTER[64] PROGMEM = {
+    0,   6,  13,  19,  25,  31,  38,  44,
+   50,  56,  62,  68,  74,  80,  86,  92,
+   98, 104, 109, 115, 121, 126, 132, 137,
+  142, 147, 152, 157, 162, 167, 172, 177,
+  181, 185, 190, 194, 198, 202, 206, 209,
+  213, 216, 220, 223, 226, 229, 231, 234,
+  237, 239, 241, 243, 245, 247, 248, 250,
+  251, 252, 253, 254, 255, 255, 255, 255,
+};
+
 /*
 static const uint8_t REVERSE_16[16] = { 0, 8,  4, 12,
                           2, 10, 6, 14 ,
@@ -99,12 +114,54 @@ template<int16_t SB_WIDTH, int16_t SB_HEIGHT> class ArdBitmap
   public:
 
     void drawCompressed(int16_t sx, int16_t sy, const uint8_t *compBitmap, uint8_t color, uint8_t align, uint8_t mirror);
-    void drawCompressedResized(int16_t sx, int16_t sy, const uint8_t *compBitmap, uint8_t color,uint8_t align, uint8_t mirror, float resize);
+    // Reduced only, a resize above 1.0 draws at the original size.
+    void drawCompressedResized(int16_t sx, int16_t sy, const uint8_t *compBitmap, uint8_t color,uint8_t align, uint8_t mirror, UQ8x8 resize);
 
     void drawBitmap(int16_t sx, int16_t sy, const uint8_t *bitmap,uint8_t w, uint8_t h, uint8_t color, uint8_t align, uint8_t mirror);
-    void drawBitmapResized(int16_t sx, int16_t sy, const uint8_t *bitmap, uint8_t w,uint8_t h, uint8_t color,uint8_t align, uint8_t mirror, float resize);
+    // Reduced or enlarged.
+    void drawBitmapResized(int16_t sx, int16_t sy, const uint8_t *bitmap, uint8_t w,uint8_t h, uint8_t color,uint8_t align, uint8_t mirror, UQ8x8 resize);
+
+    // Scaled (up or down) and rotated around its center. The angle is in
+    // 256 steps per turn, clockwise. Alignment is relative to the bounding
+    // box of the rotated bitmap.
+    void drawBitmapRotated(int16_t sx, int16_t sy, const uint8_t *bitmap, uint8_t w, uint8_t h, uint8_t color, uint8_t align, uint8_t mirror, uint8_t angle, UQ8x8 resize);
+
+    // float versions, kept for compatibility. A constant resize is
+    // converted at compile time, a variable one needs the float library.
+    void drawCompressedResized(int16_t sx, int16_t sy, const uint8_t *compBitmap, uint8_t color,uint8_t align, uint8_t mirror, float resize)
+    {
+      drawCompressedResized(sx, sy, compBitmap, color, align, mirror, UQ8x8(resize));
+    }
+    void drawBitmapResized(int16_t sx, int16_t sy, const uint8_t *bitmap, uint8_t w,uint8_t h, uint8_t color,uint8_t align, uint8_t mirror, float resize)
+    {
+      drawBitmapResized(sx, sy, bitmap, w, h, color, align, mirror, UQ8x8(resize));
+    }
+
+  private:
+
+    // sine of an angle in 256 steps per turn
+    static SQ7x8 sinAngle(uint8_t angle);
 };
 
+template<int16_t SB_WIDTH, int16_t SB_HEIGHT>
+SQ7x8 ArdBitmap<SB_WIDTH, SB_HEIGHT>::sinAngle(uint8_t angle)
+{
+  uint8_t i = angle & 0x3F;
+  int16_t value;
+
+  // the second quarter mirrors the first
+  if (angle & 0x40) {
+    i = 64 - i;
+  }
+  value = (i == 64) ? 256 : pgm_read_byte(&SIN_QUARTER[i]);
+
+  // the second half is negative
+  if (angle & 0x80) {
+    value = -value;
+  }
+  return SQ7x8::fromInternal(value);
+}
+
 ////////////////////////
 // COMPRESSED BITMAPS //
 ////////////////////////
@@ -309,17 +366,19 @@ void ArdBitmap<SB_WIDTH, SB_HEIGHT>::drawCompressed(int16_t sx, int16_t sy, cons
 
 
 template<int16_t SB_WIDTH, int16_t SB_HEIGHT>
-void ArdBitmap<SB_WIDTH, SB_HEIGHT>::drawCompressedResized(int16_t sx, int16_t sy, const uint8_t *compBitmap, uint8_t color,uint8_t align, uint8_t mirror, float resize)
+void ArdBitmap<SB_WIDTH, SB_HEIGHT>::drawCompressedResized(int16_t sx, int16_t sy, const uint8_t *compBitmap, uint8_t color,uint8_t align, uint8_t mirror, UQ8x8 resize)
 {
 
   //TODO: check if this can be done in a better way
   #ifdef RESIZE_HACK
-  if (resize >= 1.0){
+  if (resize >= UQ8x8(1)){
     return drawCompressed(sx, sy, compBitmap, color, align, mirror);
   }
   #else
-  if (resize > 1.0){
-    resize = 1.0;
+  // The bitmap is decoded in stream order and each source pixel is drawn to
+  // at most one screen pixel, so it can't be enlarged
+  if (resize > UQ8x8(1)){
+    resize = UQ8x8(1);
   }
   #endif
 
@@ -342,8 +401,12 @@ void ArdBitmap<SB_WIDTH, SB_HEIGHT>::drawCompressedResized(int16_t sx, int16_t s
   w = (byte0 & 0b01111111) + 1;
   h = (byte1 & 0b00111111) + 1;
 
-  wRes = (uint8_t)(w * resize);
-  hRes = (uint8_t)(h * resize);
+  // resize is at most 1.0 here, so the products fit 16 bits
+  wRes = (uint8_t)(((uint16_t)w * resize.getInternal()) >> 8);
+  hRes = (uint8_t)(((uint16_t)h * resize.getInternal()) >> 8);
+
+  if (wRes == 0 || hRes == 0)
+    return;
 
   if (align & ALIGN_H_CENTER) {
     sx -= (wRes / 2);
@@ -389,7 +452,12 @@ void ArdBitmap<SB_WIDTH, SB_HEIGHT>::drawCompressedResized(int16_t sx, int16_t s
   characterPos = 7;
   a = 0;
 
-  // Create Lookup tables to speed up drawing
+  // Create Lookup tables to speed up drawing. Each screen pixel is 1 / resize
+  // source pixels further on. wRes and hRes aren't 0, so resize is at least
+  // 2/256 and the step fits UQ8x8.
+
+  UQ8x8 step = UQ8x8::fromInternal(0x10000UL / resize.getInternal());
+  UQ8x8 source;
 
   uint8_t x_LUT[w];
 
@@ -397,8 +465,10 @@ void ArdBitmap<SB_WIDTH, SB_HEIGHT>::drawCompressedResized(int16_t sx, int16_t s
     x_LUT[i] = 0xFF;
   }
   // Precalculate column translation (0xFF if skipped)
+  source = UQ8x8::fromInternal(0);
   for (uint8_t i=0 ; i < wRes; i++){
-    x_LUT[((uint16_t)i  *  w) / wRes] = (mirror & MIRROR_HORIZONTAL) ? wRes - 1 - i : i;
+    x_LUT[source.getInteger()] = (mirror & MIRROR_HORIZONTAL) ? wRes - 1 - i : i;
+    source += step;
   }
 
   uint8_t y_LUT[h];
@@ -407,8 +477,10 @@ void ArdBitmap<SB_WIDTH, SB_HEIGHT>::drawCompressedResized(int16_t sx, int16_t s
     y_LUT[i] = 0xFF;
   }
 
+  source = UQ8x8::fromInternal(0);
   for (uint8_t i=0 ; i < hRes; i++){
-    y_LUT[((uint16_t)i * h) / hRes] = (mirror & MIRROR_VERTICAL) ? hRes - 1 - i : i;
+    y_LUT[source.getInteger()] = (mirror & MIRROR_VERTICAL) ? hRes - 1 - i : i;
+    source += step;
   }
 
   while (a < rows && /*a > -1*/ a != 0xFF) {
@@ -686,119 +758,232 @@ void ArdBitmap<SB_WIDTH, SB_HEIGHT>::drawBitmap(int16_t x, int16_t y, const uint
 
 
 template<int16_t SB_WIDTH, int16_t SB_HEIGHT>
-void ArdBitmap<SB_WIDTH, SB_HEIGHT>::drawBitmapResized(int16_t sx, int16_t sy, const uint8_t *bitmap, uint8_t w,uint8_t h, uint8_t color,uint8_t align, uint8_t mirror, float resize)
+void ArdBitmap<SB_WIDTH, SB_HEIGHT>::drawBitmapResized(int16_t sx, int16_t sy, const uint8_t *bitmap, uint8_t w,uint8_t h, uint8_t color,uint8_t align, uint8_t mirror, UQ8x8 resize)
 {
 
   //TODO: check if this can be done in a better way
   #ifdef RESIZE_HACK
-  if (resize >= 1.0){
+  if (resize >= UQ8x8(1)){
     return drawBitmap(sx, sy, bitmap,w, h, color, align, mirror);
   }
-  #else
-  if (resize > 1.0){
-    resize = 1.0;
-  }
   #endif
 
-  //TODO: check why int16_t sizeCounter is a bit faster than uint16_t sizeCounter
-  int16_t sizeCounter;
-  uint16_t len;
-  uint8_t a, iCol;
-  uint8_t data;
-  uint8_t  wRes,  hRes;
-  uint8_t col;
-
-  wRes = (uint8_t)(w * resize);
-  hRes = (uint8_t)(h * resize);
+  // up to 255 x 255 times the bitmap size
+  uint16_t wRes = ((uint32_t)w * resize.getInternal()) >> 8;
+  uint16_t hRes = ((uint32_t)h * resize.getInternal()) >> 8;
 
+  if (wRes == 0 || hRes == 0)
+    return;
 
   // Move positions to match alignment
+  int32_t x0 = sx;
+  int32_t y0 = sy;
+
   if (align & ALIGN_H_CENTER) {
-    sx -= (wRes / 2);
+    x0 -= (wRes / 2);
   } else if (align & ALIGN_H_RIGHT) {
-    sx -= wRes;
+    x0 -= wRes;
   }
 
   if (align & ALIGN_V_CENTER) {
-    sy -= (hRes / 2);
+    y0 -= (hRes / 2);
   } else if (align & ALIGN_V_BOTTOM) {
-    sy -= hRes;
+    y0 -= hRes;
   }
 
+  // Clip the resized bitmap to the screen
+  int16_t xStart = (x0 < 0) ? 0 : x0;
+  int16_t xEnd = (x0 + wRes > SB_WIDTH) ? SB_WIDTH - 1 : x0 + wRes - 1;
+  int16_t yStart = (y0 < 0) ? 0 : y0;
+  int16_t yEnd = (y0 + hRes > SB_HEIGHT) ? SB_HEIGHT - 1 : y0 + hRes - 1;
+
   // No need to draw at all if we're offscreen
-  if (sx + wRes < 0 || sx > SB_WIDTH - 1 || sy + hRes < 0 || sy > SB_HEIGHT - 1)
+  if (xStart > xEnd || yStart > yEnd)
     return;
 
-  int yOffset = abs(sy) % 8;
-  int sRow = sy / 8;
-  if (sy < 0) {
-    sRow--;
-    yOffset = 8 - yOffset;
+  // The screen is sampled backwards into the bitmap, so it can be enlarged
+  // as well as reduced. Each screen pixel is 1 / resize source pixels further
+  // on. wRes and hRes aren't 0, so resize is at least 2/256 and the step fits
+  // UQ8x8.
+  UQ8x8 step = UQ8x8::fromInternal(0x10000UL / resize.getInternal());
+  uint16_t first;
+
+  // Source row of each screen row, sampled at the pixel centers
+  uint8_t rows = yEnd - yStart;
+  uint8_t y_LUT[rows + 1];
+
+  first = yStart - y0;
+  if (mirror & MIRROR_VERTICAL) first = hRes - 1 - first;
+  UQ8x8 v = UQ8x8::fromInternal((uint32_t)first * step.getInternal() + step.getInternal() / 2);
+
+  for (uint8_t i = 0; i <= rows; i++) {
+    y_LUT[i] = v.getInteger();
+    if (mirror & MIRROR_VERTICAL) {
+      v -= step;
+    } else {
+      v += step;
+    }
   }
 
-  int rows = h / 8;
-  if (h % 8 != 0) rows++;
+  first = xStart - x0;
+  if (mirror & MIRROR_HORIZONTAL) first = wRes - 1 - first;
+  UQ8x8 u = UQ8x8::fromInternal((uint32_t)first * step.getInternal() + step.getInternal() / 2);
 
-  uint8_t rowsRes = hRes / 8;
-  if (hRes % 8 != 0) rowsRes++;
+  uint8_t *column = ARDBITMAP_SBUF + (yStart / 8) * SB_WIDTH + xStart;
 
-  // Init values
-  iCol = 0;
-  a = 0;
+  for (int16_t x = xStart; x <= xEnd; x++) {
+    const uint8_t *source = bitmap + u.getInteger();
+    uint8_t *buffer = column++;
+    uint8_t bits = 0;
+    uint8_t bit = BIT_SHIFT[yStart % 8];
+    uint8_t sourceRow = 0xFF;
+    uint8_t data = 0;
 
-  // Create Lookup tables to speed up drawing
+    // Collect the pixels of each screen byte and write them at once
+    for (uint8_t i = 0; ; i++) {
+      uint8_t iv = y_LUT[i];
 
-  uint8_t x_LUT[w];
+      if (iv / 8 != sourceRow) {
+        sourceRow = iv / 8;
+        data = pgm_read_byte(source + sourceRow * w);
+      }
+      if (data & BIT_SHIFT[iv % 8]) {
+        bits |= bit;
+      }
+      bit <<= 1;
 
-  for (uint8_t i=0 ; i < w; i++){
-    x_LUT[i] = 0xFF;
-  }
-  // Precalculate column translation (0xFF if skipped)
-  for (uint8_t i=0 ; i < wRes; i++){
-    x_LUT[((uint16_t)i  *  w) / wRes] = (mirror & MIRROR_HORIZONTAL) ? wRes - 1 - i : i;
+      if (bit == 0 || i == rows) {
+        if (bits) {
+          if (color) {
+            *buffer |= bits;
+          } else {
+            *buffer &= ~bits;
+          }
+        }
+        if (i == rows)
+          break;
+        buffer += SB_WIDTH;
+        bits = 0;
+        bit = 1;
+      }
+    }
+
+    if (mirror & MIRROR_HORIZONTAL) {
+      u -= step;
+    } else {
+      u += step;
+    }
   }
+}
 
-  uint8_t y_LUT[h];
+template<int16_t SB_WIDTH, int16_t SB_HEIGHT>
+void ArdBitmap<SB_WIDTH, SB_HEIGHT>::drawBitmapRotated(int16_t sx, int16_t sy, const uint8_t *bitmap, uint8_t w, uint8_t h, uint8_t color, uint8_t align, uint8_t mirror, uint8_t angle, UQ8x8 resize)
+{
+  uint16_t scale = resize.getInternal();
+  if (scale == 0)
+    return;
 
-  for (uint8_t i=0 ; i < h; i++){
-    y_LUT[i] = 0xFF;
+  int16_t sinA = sinAngle(angle).getInternal();
+  int16_t cosA = sinAngle(angle + 64).getInternal();
+
+  // Half size of the bounding box of the rotated and scaled bitmap
+  uint32_t halfWRaw = ((uint32_t)abs(cosA) * w + (uint32_t)abs(sinA) * h + 1) >> 1;
+  uint32_t halfHRaw = ((uint32_t)abs(sinA) * w + (uint32_t)abs(cosA) * h + 1) >> 1;
+  int16_t halfW = ((halfWRaw * scale) >> 16) + 1;
+  int16_t halfH = ((halfHRaw * scale) >> 16) + 1;
+
+  // Move center to match alignment
+  if (!(align & ALIGN_H_CENTER)) {
+    sx += (align & ALIGN_H_RIGHT) ? -halfW : halfW;
   }
 
-  for (uint8_t i=0 ; i < hRes; i++){
-    y_LUT[((uint16_t)i * h) / hRes] = (mirror & MIRROR_VERTICAL) ?  hRes - 1 - i : i;
+  if (!(align & ALIGN_V_CENTER)) {
+    sy += (align & ALIGN_V_BOTTOM) ? -halfH : halfH;
   }
 
-  len = w * rows;
+  // Clip the bounding box to the screen
+  int16_t xStart = sx - halfW;
+  int16_t xEnd = sx + halfW;
+  int16_t yStart = sy - halfH;
+  int16_t yEnd = sy + halfH;
 
-  for (uint16_t i = 0; i < len ; i++){
+  if (xStart < 0) xStart = 0;
+  if (xEnd > SB_WIDTH - 1) xEnd = SB_WIDTH - 1;
+  if (yStart < 0) yStart = 0;
+  if (yEnd > SB_HEIGHT - 1) yEnd = SB_HEIGHT - 1;
 
-    data = pgm_read_byte(&bitmap[i]);
-    int aRow8 = a * 8;
-    int16_t iColMod =  x_LUT[iCol] + sx;
+  // No need to draw at all if we're offscreen
+  if (xStart > xEnd || yStart > yEnd)
+    return;
 
-    // Skip if column not needed
-    if (x_LUT[iCol] != 0xFF && iColMod < SB_WIDTH && iColMod >= 0){
-      for (uint8_t s = 0; s < 8 ;s++){
-        if (y_LUT[aRow8+s] != 0xFF && data &  BIT_SHIFT[s]){
-          //TODO: CHECK LIMITS ON LUT?
-          uint8_t row = (uint8_t)(y_LUT[aRow8+s]+sy) / 8;
+  // Source pixels moved for each screen pixel, going right (X) and down (Y).
+  // The screen is sampled backwards into the bitmap, so every screen pixel
+  // is drawn once whatever the scale.
+  SQ15x16 uStepX = SQ15x16::fromInternal(((int32_t)cosA << 16) / scale);
+  SQ15x16 vStepX = SQ15x16::fromInternal(-((int32_t)sinA << 16) / scale);
+  SQ15x16 uStepY = SQ15x16::fromInternal(((int32_t)sinA << 16) / scale);
+  SQ15x16 vStepY = SQ15x16::fromInternal(((int32_t)cosA << 16) / scale);
 
-          if (row < (SB_HEIGHT / 8)) {
-            if (color) {
-              ARDBITMAP_SBUF[(row*SB_WIDTH) + (uint8_t)iColMod] |=   BIT_SHIFT[((uint8_t)(y_LUT[aRow8+s]+sy) % 8)];
-            } else {
-              ARDBITMAP_SBUF[(row*SB_WIDTH) + (uint8_t)iColMod] &= ~ BIT_SHIFT[((uint8_t)(y_LUT[aRow8+s]+sy) % 8)];
-            }
+  if (mirror & MIRROR_HORIZONTAL) {
+    uStepX = -uStepX;
+    uStepY = -uStepY;
+  }
+  if (mirror & MIRROR_VERTICAL) {
+    vStepX = -vStepX;
+    vStepY = -vStepY;
+  }
+
+  // Source position of the center of the first screen pixel
+  int16_t dx = xStart - sx;
+  int16_t dy = yStart - sy;
+  SQ15x16 uColumn = SQ15x16::fromInternal(((int32_t)w << 15) +
+    uStepX.getInternal() * dx + uStepY.getInternal() * dy +
+    (uStepX.getInternal() + uStepY.getInternal()) / 2);
+  SQ15x16 vColumn = SQ15x16::fromInternal(((int32_t)h << 15) +
+    vStepX.getInternal() * dx + vStepY.getInternal() * dy +
+    (vStepX.getInternal() + vStepY.getInternal()) / 2);
+
+  uint8_t *column = ARDBITMAP_SBUF + (yStart / 8) * SB_WIDTH + xStart;
+
+  for (int16_t x = xStart; x <= xEnd; x++) {
+    SQ15x16 u = uColumn;
+    SQ15x16 v = vColumn;
+    uint8_t *buffer = column++;
+    uint8_t bits = 0;
+    uint8_t bit = BIT_SHIFT[yStart % 8];
+
+    // Collect the pixels of each screen byte and write them at once
+    for (int16_t y = yStart; ; y++) {
+      // negative positions become large and fail the range checks
+      uint16_t iu = u.getInteger();
+      uint16_t iv = v.getInteger();
+
+      if (iu < w && iv < h &&
+          (pgm_read_byte(&bitmap[(iv / 8) * w + iu]) & BIT_SHIFT[iv % 8])) {
+        bits |= bit;
+      }
+      u += uStepY;
+      v += vStepY;
+      bit <<= 1;
+
+      if (bit == 0 || y == yEnd) {
+        if (bits) {
+          if (color) {
+            *buffer |= bits;
+          } else {
+            *buffer &= ~bits;
           }
-         }
+        }
+        if (y == yEnd)
+          break;
+        buffer += SB_WIDTH;
+        bits = 0;
+        bit = 1;
       }
     }
 
-    iCol++;
-    if (iCol >= w){
-        iCol = 0;
-        a++;
-    }
+    uColumn += uStepX;
+    vColumn += vStepX;
   }
 }
 
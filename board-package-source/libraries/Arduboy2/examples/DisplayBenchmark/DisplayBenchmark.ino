@@ -0,0 +1,77 @@
+/*
+DisplayBenchmark
+
+Measures how long it takes to send the screen buffer to the display and how
+much of that time the sketch has for itself.
+
+Build it once as is and once with ARDUBOY_I2C_TWI (and optionally
+ARDUBOY_BACKGROUND_DISPLAY) defined in Arduboy2Core.h to compare the bit
+banged and the hardware TWI transfer of an I2C display. The results are
+updated every second:
+
+ frame:  the time from starting one display() until the display could
+         start the next one, in microseconds
+ call:   the time spent in the display() call itself
+ free:   the percentage of the frame time the sketch can use for its own
+         code (only more than 0 with a background transfer)
+ kB/s:   the number of bytes sent to the display per second
+
+This example is in the public domain.
+*/
+
+#include <Arduboy2.h>
+
+Arduboy2 arduboy;
+
+constexpr uint8_t frames = 32;
+
+unsigned long frameTime;
+unsigned long callTime;
+
+void setup()
+{
+  arduboy.begin();
+}
+
+void measure()
+{
+  unsigned long inCall = 0;
+  unsigned long start = micros();
+  for (uint8_t i = 0; i < frames; i++)
+  {
+    unsigned long t = micros();
+    arduboy.display();
+    inCall += micros() - t;
+    while (arduboy.displayBusy()) { }
+  }
+  frameTime = (micros() - start) / frames;
+  callTime = inCall / frames;
+}
+
+void loop()
+{
+  measure();
+
+  arduboy.clear();
+#ifdef ARDUBOY_I2C_TWI
+  arduboy.println(F("TWI"));
+#elif defined(OLED_SSD1306_I2C) || defined(OLED_SSD1306_I2CX)
+  arduboy.println(F("bit banged I2C"));
+#else
+  arduboy.println(F("SPI"));
+#endif
+#ifdef ARDUBOY_BACKGROUND_DISPLAY
+  arduboy.println(F("background"));
+#endif
+  arduboy.print(F("frame: "));
+  arduboy.println(frameTime);
+  arduboy.print(F("call:  "));
+  arduboy.println(callTime);
+  arduboy.print(F("free:  "));
+  arduboy.print(100 - callTime * 100 / frameTime);
+  arduboy.println('%');
+  arduboy.print(F("kB/s:  "));
+  arduboy.println(1000000UL / 1024 * (WIDTH * HEIGHT / 8) / frameTime);
+
+  arduboy.delayShort(1000);
+}
@@ -12,6 +12,22 @@
 
 uint8_t Arduboy2Base::sBuffer[];
 
+uint8_t Arduboy2Base::grayPhase = 0;
+
+#if !(defined(GU12864_800B) || defined(OLED_96X96) || defined(OLED_128X96) || defined(OLED_128X128) || defined(OLED_128X64_ON_96X96) || defined(OLED_128X64_ON_128X96) || defined(OLED_128X64_ON_128X128) || defined(OLED_128X96_ON_128X128) || defined(OLED_96X96_ON_128X128) || defined(OLED_64X128_ON_128X128))
+uint8_t Arduboy2Base::scrollX = 0;
+uint8_t Arduboy2Base::scrollY = 0;
+#endif
+
+#ifdef ARDUBOY_GRAY4
+int16_t Arduboy2Base::gray4Left = 0;
+#endif
+
+#ifdef ARDUBOY_DIRTY_RECT
+Arduboy2Base::DirtySpan Arduboy2Base::dirtySpans[];
+Arduboy2Base::DirtySpan Arduboy2Base::drawnSpans[];
+#endif
+
 Arduboy2Base::Arduboy2Base()
 {
   currentButtonState = 0;
@@ -20,6 +36,16 @@ Arduboy2Base::Arduboy2Base()
   setFrameRate(60);
   frameCount = 0;
   justRendered = false;
+ #ifdef ARDUBOY_DIRTY_RECT
+  // the display contents are unknown, so all of it has to be painted
+  for (uint8_t page = 0; page < HEIGHT / 8; page++)
+  {
+    dirtySpans[page].start = 0;
+    dirtySpans[page].end = WIDTH - 1;
+    drawnSpans[page].start = 0xFF;
+    drawnSpans[page].end = 0;
+  }
+ #endif
 }
 
 // functions called here should be public so users can create their
@@ -232,11 +258,17 @@ void Arduboy2Base::waitNoButtons() {
 void Arduboy2Base::setFrameRate(uint8_t rate)
 {
   eachFrameMillis = 1000 / rate;
+ #ifdef ARDUBOY_DISPLAY_SYNC
+  setDisplayRefresh(eachFrameMillis);
+ #endif
 }
 
 void Arduboy2Base::setFrameDuration(uint8_t duration)
 {
   eachFrameMillis = duration;
+ #ifdef ARDUBOY_DISPLAY_SYNC
+  setDisplayRefresh(eachFrameMillis);
+ #endif
 }
 
 bool Arduboy2Base::everyXFrames(uint8_t frames)
@@ -327,6 +359,10 @@ void Arduboy2Base::drawPixel(int16_t x, int16_t y, uint8_t color)
   }
   #endif
 
+ #ifdef ARDUBOY_DIRTY_RECT
+  markDirtySpan(y >> 3, x, x);
+ #endif
+
   uint16_t row_offset;
   uint8_t bit;
  #if defined __AVR_ARCH__
@@ -478,7 +514,11 @@ void Arduboy2Base::fillCircleHelper
   int16_t ddF_y = -2 * r;
   int16_t x = 0;
   int16_t y = r;
+  int16_t px = x; // previous x and y
+  int16_t py = y;
 
+  // Each column is only filled once, with its full height, so the byte
+  // spans aren't written over again as the octants are walked.
   while (x < y)
   {
     if (f >= 0)
@@ -492,17 +532,51 @@ void Arduboy2Base::fillCircleHelper
     ddF_x += 2;
     f += ddF_x;
 
-    if (sides & 0x1) // right side
+    if (x <= y)
     {
-      drawFastVLine(x0+x, y0-y, 2*y+1+delta, color);
-      drawFastVLine(x0+y, y0-x, 2*x+1+delta, color);
+      if (sides & 0x1) // right side
+      {
+        drawFastVLine(x0+x, y0-y, 2*y+1+delta, color);
+      }
+      if (sides & 0x2) // left side
+      {
+        drawFastVLine(x0-x, y0-y, 2*y+1+delta, color);
+      }
     }
 
-    if (sides & 0x2) // left side
+    // column py is complete when y moves on
+    if (y != py)
     {
-      drawFastVLine(x0-x, y0-y, 2*y+1+delta, color);
-      drawFastVLine(x0-y, y0-x, 2*x+1+delta, color);
+      if (sides & 0x1) // right side
+      {
+        drawFastVLine(x0+py, y0-px, 2*px+1+delta, color);
+      }
+      if (sides & 0x2) // left side
+      {
+        drawFastVLine(x0-py, y0-px, 2*px+1+delta, color);
+      }
+      py = y;
     }
+    px = x;
+  }
+}
+
+// Change the bits of a screen buffer byte to a line's color
+static inline void drawLineBits(uint8_t *pBuf, uint8_t bits, uint8_t color)
+{
+  switch (color)
+  {
+    case WHITE:
+      *pBuf |= bits;
+      break;
+
+    case BLACK:
+      *pBuf &= ~bits;
+      break;
+
+    default:
+      *pBuf ^= bits;
+      break;
   }
 }
 
@@ -510,6 +584,8 @@ void Arduboy2Base::drawLine
 (int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint8_t color)
 {
   // bresenham's algorithm - thx wikpedia
+  // The line is clipped to the screen without changing which pixels are
+  // drawn, then walked through the screen buffer a pixel at a time.
   bool steep = abs(y1 - y0) > abs(x1 - x0);
   if (steep) {
     swapInt16(x0, y0);
@@ -521,39 +597,148 @@ void Arduboy2Base::drawLine
     swapInt16(y0, y1);
   }
 
+  // the screen size along the x (major) and y (minor) axis of the line
+  int16_t xSize = steep ? HEIGHT : WIDTH;
+  int16_t ySize = steep ? WIDTH : HEIGHT;
+
+  // Cohen-Sutherland rejection: both ends are beyond the same screen edge
+  if (x1 < 0 || x0 >= xSize || (y0 < 0 && y1 < 0) ||
+      (y0 >= ySize && y1 >= ySize))
+    return;
+
   int16_t dx, dy;
   dx = x1 - x0;
   dy = abs(y1 - y0);
 
   int16_t err = dx / 2;
-  int8_t ystep;
+  int8_t ystep = (y0 < y1) ? 1 : -1;
 
-  if (y0 < y1)
+  // Find the first step of the line on the screen. After k steps, y has
+  // moved by ceil((k * dy - dx / 2) / dx) pixels.
+  int16_t skip = (x0 < 0) ? -x0 : 0;
+  int16_t yOutside = (ystep > 0) ? -y0 : y0 - (ySize - 1);
+  if (yOutside > 0)
   {
-    ystep = 1;
+    int16_t yEnter = ((int32_t)(yOutside - 1) * dx + dx / 2) / dy + 1;
+    if (yEnter > skip)
+      skip = yEnter;
   }
-  else
+
+  if (skip > 0)
   {
-    ystep = -1;
+    if (skip > dx)
+      return;
+
+    int32_t t = (int32_t)skip * dy - dx / 2;
+    int16_t ySteps = (t > 0) ? (t + dx - 1) / dx : 0;
+    x0 += skip;
+    y0 += ySteps * ystep;
+    err = dx / 2 - (int32_t)skip * dy + (int32_t)ySteps * dx;
+
+    // the line passes outside a corner of the screen
+    if (x0 >= xSize || y0 < 0 || y0 >= ySize)
+      return;
   }
 
-  for (; x0 <= x1; x0++)
+  // stop at the last step on the screen
+  uint8_t count = ((x1 < xSize) ? x1 : xSize - 1) - x0 + 1;
+
+ #ifdef ARDUBOY_DIRTY_RECT
   {
+    int16_t yLow = (y0 < y1) ? y0 : y1;
+    int16_t yHigh = (y0 < y1) ? y1 : y0;
+    if (yLow < 0)
+      yLow = 0;
+    if (yHigh > ySize - 1)
+      yHigh = ySize - 1;
+
+    uint8_t h = yHigh - yLow + 1;
     if (steep)
-    {
-      drawPixel(y0, x0, color);
-    }
+      markDirty(yLow, x0, h, count);
     else
+      markDirty(x0, yLow, count, h);
+  }
+ #endif
+
+  if (!steep)
+  {
+    // one pixel in each column: step the buffer pointer to the next column
+    // and the pixel mask up or down
+    uint8_t *pBuf = sBuffer + ((y0 / 8) * WIDTH) + x0;
+    uint8_t mask = 1 << (y0 & 7);
+
+    while (true)
     {
-      drawPixel(x0, y0, color);
+      drawLineBits(pBuf++, mask, color);
+      if (--count == 0)
+        break;
+
+      err -= dy;
+      if (err < 0)
+      {
+        err += dx;
+        y0 += ystep;
+        if (y0 < 0 || y0 >= HEIGHT)
+          break;
+
+        if (ystep > 0)
+        {
+          mask <<= 1;
+          if (mask == 0)
+          {
+            mask = 0x01;
+            pBuf += WIDTH;
+          }
+        }
+        else
+        {
+          mask >>= 1;
+          if (mask == 0)
+          {
+            mask = 0x80;
+            pBuf -= WIDTH;
+          }
+        }
+      }
     }
+  }
+  else
+  {
+    // a run of pixels in the same column is collected into one byte and
+    // written when the line moves to another column or page
+    uint8_t *pBuf = sBuffer + ((x0 / 8) * WIDTH) + y0;
+    uint8_t mask = 1 << (x0 & 7);
+    uint8_t bits = 0;
 
-    err -= dy;
-    if (err < 0)
+    while (true)
     {
-      y0 += ystep;
-      err += dx;
+      bits |= mask;
+      if (--count == 0)
+        break;
+
+      mask <<= 1;
+      if (mask == 0)
+      {
+        drawLineBits(pBuf, bits, color);
+        bits = 0;
+        mask = 0x01;
+        pBuf += WIDTH;
+      }
+
+      err -= dy;
+      if (err < 0)
+      {
+        err += dx;
+        y0 += ystep;
+        if (y0 < 0 || y0 >= WIDTH)
+          break;
+
+        drawLineBits(pBuf, bits, color);
+        bits = 0;
+        pBuf += ystep;
+      }
     }
+    drawLineBits(pBuf, bits, color);
   }
 }
 
@@ -569,11 +754,7 @@ void Arduboy2Base::drawRect
 void Arduboy2Base::drawFastVLine
 (int16_t x, int16_t y, uint8_t h, uint8_t color)
 {
-  int end = y+h;
-  for (int a = max(0,y); a < min(end,HEIGHT); a++)
-  {
-    drawPixel(x,a,color);
-  }
+  fillRect(x, y, 1, h, color);
 }
 
 void Arduboy2Base::drawFastHLine
@@ -602,6 +783,10 @@ void Arduboy2Base::drawFastHLine
   // calculate actual width (even if unchanged)
   w = xEnd - x;
 
+ #ifdef ARDUBOY_DIRTY_RECT
+  markDirtySpan(y / 8, x, xEnd - 1);
+ #endif
+
   // buffer pointer plus row offset + x offset
   register uint8_t *pBuf = sBuffer + ((y / 8) * WIDTH) + x;
 
@@ -630,10 +815,91 @@ void Arduboy2Base::drawFastHLine
 void Arduboy2Base::fillRect
 (int16_t x, int16_t y, uint8_t w, uint8_t h, uint8_t color)
 {
-  // stupidest version - update in subclasses if desired!
-  for (int16_t i=x; i<x+w; i++)
+  int16_t xEnd = x + w; // last x point + 1
+  int16_t yEnd = y + h; // last y point + 1
+
+  // clip to the screen
+  if (x < 0)
+    x = 0;
+  if (y < 0)
+    y = 0;
+  if (xEnd > WIDTH)
+    xEnd = WIDTH;
+  if (yEnd > HEIGHT)
+    yEnd = HEIGHT;
+  if (x >= xEnd || y >= yEnd)
+    return;
+
+  fillSpans(x, xEnd - x, y, yEnd - 1, color);
+}
+
+void Arduboy2Base::fillSpans
+(uint8_t x, uint8_t w, uint8_t top, uint8_t bottom, uint8_t color)
+{
+  uint8_t page = top / 8;
+  uint8_t lastPage = bottom / 8;
+  uint8_t* pColumn = sBuffer + (page * WIDTH) + x;
+
+  // bits of the first page at or below top
+  uint8_t mask = 0xFF << (top & 7);
+
+  // other colors are drawn by their lowest bit, the same as drawPixel()
+  if (color != INVERT)
   {
-    drawFastVLine(i, y, h, color);
+    color &= 1;
+  }
+
+  while (true)
+  {
+    if (page == lastPage)
+    {
+      // bits of the last page at or above bottom
+      mask &= 0xFF >> (7 - (bottom & 7));
+    }
+
+   #ifdef ARDUBOY_DIRTY_RECT
+    markDirtySpan(page, x, x + w - 1);
+   #endif
+
+    register uint8_t *pBuf = pColumn;
+    uint8_t n = w;
+
+    // whole bytes don't need to be read first
+    switch (color)
+    {
+      case WHITE:
+        if (mask == 0xFF)
+        {
+          do { *pBuf++ = 0xFF; } while (--n);
+        }
+        else
+        {
+          do { *pBuf++ |= mask; } while (--n);
+        }
+        break;
+
+      case BLACK:
+        if (mask == 0xFF)
+        {
+          do { *pBuf++ = 0; } while (--n);
+        }
+        else
+        {
+          uint8_t clr = ~mask;
+          do { *pBuf++ &= clr; } while (--n);
+        }
+        break;
+
+      case INVERT:
+        do { *pBuf++ ^= mask; } while (--n);
+        break;
+    }
+
+    if (page == lastPage)
+      return;
+    page++;
+    pColumn += WIDTH;
+    mask = 0xFF;
   }
 }
 
@@ -650,6 +916,23 @@ void Arduboy2Base::fillScreen(uint8_t color)
   //    sBuffer[i] = color;
   // }
 
+ #ifdef ARDUBOY_DIRTY_RECT
+  for (uint8_t page = 0; page < HEIGHT / 8; page++)
+  {
+    if (color != BLACK)
+    {
+      markDirtySpan(page, 0, WIDTH - 1);
+    }
+    else
+    {
+      // only the areas drawn to since the last clear have changed
+      markDirtySpan(page, drawnSpans[page].start, drawnSpans[page].end);
+      drawnSpans[page].start = 0xFF;
+      drawnSpans[page].end = 0;
+    }
+  }
+ #endif
+
   // This asm version is semi hard coded for 128x64, 96x96 and 128x96 resolutions
   
   // local variable for screen buffer pointer,
@@ -725,11 +1008,50 @@ void Arduboy2Base::drawTriangle
   drawLine(x2, y2, x0, y0, color);
 }
 
+// Steps along a triangle edge one row at a time. x is the same as
+// x0 + dx * row / dy rounded toward 0, but it's found by adding the whole
+// and fractional parts of dx / dy instead of dividing for each row.
+struct TriangleEdge
+{
+  int16_t x;      // x at the current row
+  int16_t step;   // whole part of dx / dy
+  int8_t dir;     // 1 or -1, the sign of dx
+  uint16_t frac;  // remainder of |dx| / dy
+  uint16_t sum;   // remainders added so far, 0 to dy - 1
+  uint16_t dy;
+
+  void begin(int16_t x0, int16_t dx, int16_t edgeDy)
+  {
+    uint16_t adx = (dx < 0) ? -dx : dx;
+    dir = (dx < 0) ? -1 : 1;
+    dy = edgeDy;
+    x = x0;
+    step = dir * (int16_t)(adx / dy);
+    frac = adx % dy;
+    sum = 0;
+  }
+
+  void next()
+  {
+    x += step;
+    sum += frac;
+    if (sum >= dy)
+    {
+      sum -= dy;
+      x += dir;
+    }
+  }
+};
+
 void Arduboy2Base::fillTriangle
 (int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint8_t color)
 {
+  // The triangle is filled a row at a time, the same as the classic
+  // version. The edges are stepped without dividing, and the rows of each
+  // page are collected so the columns they all cover are filled a whole
+  // byte at a time by fillTriangleRows().
 
-  int16_t a, b, y, last;
+  int16_t a, b;
   // Sort coordinates by Y order (y2 >= y1 >= y0)
   if (y0 > y1)
   {
@@ -763,68 +1085,104 @@ void Arduboy2Base::fillTriangle
     {
       b = x2;
     }
-    drawFastHLine(a, y0, b-a+1, color);
+    if (y0 >= 0 && y0 < HEIGHT)
+    {
+      fillTriangleRows(&a, &b, y0, y0, color);
+    }
     return;
   }
 
-  int16_t dx01 = x1 - x0,
-      dy01 = y1 - y0,
-      dx02 = x2 - x0,
-      dy02 = y2 - y0,
-      dx12 = x2 - x1,
-      dy12 = y2 - y1,
-      sa = 0,
-      sb = 0;
-
-  // For upper part of triangle, find scanline crossings for segments
-  // 0-1 and 0-2.  If y1=y2 (flat-bottomed triangle), the scanline y1
-  // is included here (and second loop will be skipped, avoiding a /0
-  // error there), otherwise scanline y1 is skipped here and handled
-  // in the second loop...which also avoids a /0 error here if y0=y1
+  // Edge b is segment 0-2. Edge a is segment 0-1 for the upper part of the
+  // triangle and segment 1-2 for the lower part. If y1=y2 (flat-bottomed
+  // triangle), the scanline y1 is part of the upper part, otherwise it's
+  // the first of the lower part...which also avoids a /0 error if y0=y1
   // (flat-topped triangle).
-  if (y1 == y2)
+  TriangleEdge edgeA, edgeB;
+  edgeB.begin(x0, x2 - x0, y2 - y0);
+  if (y1 > y0)
   {
-    last = y1;   // Include y1 scanline
-  }
-  else
-  {
-    last = y1-1; // Skip it
+    edgeA.begin(x0, x1 - x0, y1 - y0);
   }
 
+  int16_t left[8], right[8]; // spans of the rows collected for a page
+  uint8_t rows = 0;
+  int16_t last = (y2 < HEIGHT) ? y2 : HEIGHT - 1;
 
-  for(y = y0; y <= last; y++)
+  for (int16_t y = y0; y <= last; y++)
   {
-    a   = x0 + sa / dy01;
-    b   = x0 + sb / dy02;
-    sa += dx01;
-    sb += dx02;
+    if (y == y1 && y1 != y2)
+    {
+      edgeA.begin(x1, x2 - x1, y2 - y1);
+    }
 
-    if(a > b)
+    if (y >= 0)
     {
-      swapInt16(a,b);
+      a = edgeA.x;
+      b = edgeB.x;
+      if(a > b)
+      {
+        swapInt16(a,b);
+      }
+      left[rows] = a;
+      right[rows] = b;
+      rows++;
+
+      if ((y & 7) == 7 || y == last)
+      {
+        fillTriangleRows(left, right, y - rows + 1, y, color);
+        rows = 0;
+      }
     }
 
-    drawFastHLine(a, y, b-a+1, color);
+    edgeA.next();
+    edgeB.next();
   }
+}
 
-  // For lower part of triangle, find scanline crossings for segments
-  // 0-2 and 1-2.  This loop is skipped if y1=y2.
-  sa = dx12 * (y - y1);
-  sb = dx02 * (y - y0);
+void Arduboy2Base::fillTriangleRows
+(const int16_t* left, const int16_t* right, uint8_t top, uint8_t bottom,
+ uint8_t color)
+{
+  uint8_t rows = bottom - top + 1;
 
-  for(; y <= y2; y++)
+  // the columns covered by all rows, clipped to the screen
+  int16_t inLeft = 0;
+  int16_t inRight = WIDTH - 1;
+  for (uint8_t i = 0; i < rows; i++)
   {
-    a   = x1 + sa / dy12;
-    b   = x0 + sb / dy02;
-    sa += dx12;
-    sb += dx02;
+    if (left[i] > inLeft)
+      inLeft = left[i];
+    if (right[i] < inRight)
+      inRight = right[i];
+  }
 
-    if(a > b)
+  if (inLeft <= inRight)
+  {
+    fillSpans(inLeft, inRight - inLeft + 1, top, bottom, color);
+  }
+  else
+  {
+    // no columns in common, the rows are filled on their own
+    inLeft = WIDTH;
+    inRight = WIDTH - 1;
+  }
+
+  // the parts of each row left and right of the common columns
+  for (uint8_t i = 0; i < rows; i++)
+  {
+    int16_t start = (left[i] > 0) ? left[i] : 0;
+    int16_t end = (right[i] < inLeft - 1) ? right[i] : inLeft - 1;
+    if (start <= end)
     {
-      swapInt16(a,b);
+      fillSpans(start, end - start + 1, top + i, top + i, color);
     }
 
-    drawFastHLine(a, y, b-a+1, color);
+    start = (left[i] > inRight + 1) ? left[i] : inRight + 1;
+    end = (right[i] < WIDTH - 1) ? right[i] : WIDTH - 1;
+    if (start <= end)
+    {
+      fillSpans(start, end - start + 1, top + i, top + i, color);
+    }
   }
 }
 
@@ -836,6 +1194,10 @@ void Arduboy2Base::drawBitmap
   if (x + w <= 0 || x > WIDTH - 1 || y + h <= 0 || y > HEIGHT - 1)
     return;
 
+ #ifdef ARDUBOY_DIRTY_RECT
+  markDirty(x, y, w, h);
+ #endif
+
   int8_t yOffset = y & 7;
   int8_t sRow = y >> 3;
   uint8_t rows = h >> 3;
@@ -892,34 +1254,76 @@ void Arduboy2Base::drawSlowXYBitmap
 struct Arduboy2Base::BitStreamReader
 {
   const uint8_t *source;
-  uint16_t sourceIndex;
-  uint8_t bitBuffer;
-  uint8_t byteBuffer;
+  uint8_t byteBuffer; // unread bits of the current byte, next bit in bit 0
+  uint8_t bitsLeft;   // number of unread bits in byteBuffer
 
   BitStreamReader(const uint8_t *source)
-    : source(source), sourceIndex(), bitBuffer(), byteBuffer()
+    : source(source), byteBuffer(), bitsLeft()
   {
   }
 
+  // read bits LSB first, as many at a time as the current byte holds
   uint16_t readBits(uint8_t bitCount)
   {
     uint16_t result = 0;
-    for (uint8_t i = 0; i < bitCount; i++)
+    uint8_t shift = 0;
+    while (shift < bitCount)
     {
-      if (this->bitBuffer == 0)
+      if (this->bitsLeft == 0)
       {
-        this->bitBuffer = 0x1;
-        this->byteBuffer = pgm_read_byte(&this->source[this->sourceIndex]);
-        ++this->sourceIndex;
+        this->byteBuffer = pgm_read_byte(this->source++);
+        this->bitsLeft = 8;
       }
 
-      if ((this->byteBuffer & this->bitBuffer) != 0)
-        result |= (1 << i);
+      uint8_t take = bitCount - shift;
+      if (take > this->bitsLeft)
+        take = this->bitsLeft;
 
-      this->bitBuffer += this->bitBuffer;
+      result |= (uint16_t)(this->byteBuffer & (0xFF >> (8 - take))) << shift;
+      this->byteBuffer >>= take;
+      this->bitsLeft -= take;
+      shift += take;
     }
     return result;
   }
+
+  // read the leading 0 bits of an Elias gamma code and the 1 bit ending
+  // them, returning the number of 0 bits
+  uint8_t readZeros()
+  {
+    uint8_t zeros = 0;
+
+    // whole bytes of zeros
+    while (this->byteBuffer == 0)
+    {
+      zeros += this->bitsLeft;
+      this->byteBuffer = pgm_read_byte(this->source++);
+      this->bitsLeft = 8;
+    }
+
+    // the zeros before the lowest 1 bit of the byte
+    uint8_t b = this->byteBuffer;
+    uint8_t n = 0;
+    if ((b & 0x0F) == 0)
+    {
+      b >>= 4;
+      n += 4;
+    }
+    if ((b & 0x03) == 0)
+    {
+      b >>= 2;
+      n += 2;
+    }
+    if ((b & 0x01) == 0)
+    {
+      b >>= 1;
+      n += 1;
+    }
+
+    this->byteBuffer = b >> 1;
+    this->bitsLeft -= n + 1;
+    return zeros + n;
+  }
 };
 
 void Arduboy2Base::drawCompressed(int16_t sx, int16_t sy, const uint8_t *bitmap, uint8_t color)
@@ -936,6 +1340,10 @@ void Arduboy2Base::drawCompressed(int16_t sx, int16_t sy, const uint8_t *bitmap,
   if ((sx + width <= 0) || (sx > WIDTH - 1) || (sy + height <= 0) || (sy > HEIGHT - 1))
     return;
 
+ #ifdef ARDUBOY_DIRTY_RECT
+  markDirty(sx, sy, width, height);
+ #endif
+
   // sy = sy - (frame * height);
   int yOffset = abs(sy) % 8;
   int startRow = sy / 8;
@@ -951,28 +1359,39 @@ void Arduboy2Base::drawCompressed(int16_t sx, int16_t sy, const uint8_t *bitmap,
   int columnOffset = 0;
 
   uint8_t byte = 0x00;
-  uint8_t bit = 0x01;
+  uint8_t bitCount = 0; // bits of byte decoded so far
   while (rowOffset < rows) // + (frame*rows))
   {
-    uint16_t bitLength = 1;
-    while (cs.readBits(1) == 0)
-      bitLength += 2;
+    uint16_t len = cs.readBits(cs.readZeros() * 2 + 1) + 1; // span length
 
-    uint16_t len = cs.readBits(bitLength) + 1; // span length
-
-    // draw the span
-    for (uint16_t i = 0; i < len; ++i)
+    // draw the span, up to a whole byte at a time
+    while (len != 0)
     {
+      uint8_t bits = 8 - bitCount;
+      if (len < bits)
+        bits = len;
+
       if (spanColour != 0)
-        byte |= bit;
-      bit <<= 1;
+        byte |= (uint8_t)(0xFF >> (8 - bits)) << bitCount;
+      bitCount += bits;
+      len -= bits;
 
-      if (bit == 0) // reached end of byte
+      if (bitCount < 8)
+        break;
+
+      uint16_t skip = 1; // bytes to move on by
+      if (byte == 0)
+      {
+        // bytes of only unset bits don't change the buffer, so the rest
+        // of them in this span are skipped in one go
+        skip += len / 8;
+        len %= 8;
+      }
+      else
       {
         // draw
         int bRow = startRow + rowOffset;
 
-        //if (byte) // possible optimisation
         if ((bRow <= (HEIGHT / 8) - 1) && (bRow > -2) &&
             (columnOffset + sx <= (WIDTH - 1)) && (columnOffset + sx >= 0))
         {
@@ -998,19 +1417,19 @@ void Arduboy2Base::drawCompressed(int16_t sx, int16_t sy, const uint8_t *bitmap,
               sBuffer[index] &= ~value;
           }
         }
+      }
 
-        // iterate
-        ++columnOffset;
-        if (columnOffset >= width)
-        {
-          columnOffset = 0;
-          ++rowOffset;
-        }
-
-        // reset byte
-        byte = 0x00;
-        bit = 0x01;
+      // iterate
+      columnOffset += skip;
+      while (columnOffset >= width)
+      {
+        columnOffset -= width;
+        ++rowOffset;
       }
+
+      // reset byte
+      byte = 0x00;
+      bitCount = 0;
     }
 
     spanColour ^= 0x01; // toggle colour bit (bit 0) for next span
@@ -1019,14 +1438,435 @@ void Arduboy2Base::drawCompressed(int16_t sx, int16_t sy, const uint8_t *bitmap,
 
 void Arduboy2Base::display()
 {
+ #ifdef ARDUBOY_BACKGROUND_DISPLAY
+  paintScreenBackground(sBuffer);
+ #else
+  resetStartLine();
   paintScreen(sBuffer);
+ #endif
+ #ifdef ARDUBOY_DIRTY_RECT
+  resetDirtySpans(false);
+ #endif
 }
 
 void Arduboy2Base::display(bool clear)
 {
+ #ifdef ARDUBOY_BACKGROUND_DISPLAY
+  paintScreenBackground(sBuffer, clear);
+ #else
+  resetStartLine();
   paintScreen(sBuffer, clear);
+ #endif
+ #ifdef ARDUBOY_DIRTY_RECT
+  resetDirtySpans(clear);
+ #endif
+}
+
+void Arduboy2Base::displayDirty(bool clear)
+{
+#if defined(ARDUBOY_DIRTY_RECT) && !(defined(OLED_96X96) || defined(OLED_128X96) || defined(OLED_128X128) || defined(OLED_128X64_ON_96X96) || defined(OLED_128X64_ON_128X96) || defined(OLED_128X64_ON_128X128) || defined(OLED_128X96_ON_128X128) || defined(OLED_96X96_ON_128X128) || defined(OLED_64X128_ON_128X128))
+ #ifdef ARDUBOY_DISPLAY_SYNC
+  parkDisplay();
+ #endif
+  resetStartLine();
+  for (uint8_t page = 0; page < HEIGHT / 8; page++)
+  {
+    DirtySpan span = dirtySpans[page];
+    if (span.start <= span.end)
+    {
+      paintScreenSpan(sBuffer, page, span.start, span.end);
+    }
+    if (clear)
+    {
+      span = drawnSpans[page];
+      if (span.start <= span.end)
+      {
+        memset(sBuffer + page * WIDTH + span.start, 0, span.end - span.start + 1);
+      }
+    }
+  }
+ #ifdef ARDUBOY_DISPLAY_SYNC
+  unparkDisplay();
+ #endif
+  resetDirtySpans(clear);
+#else
+  display(clear);
+#endif
+}
+
+void Arduboy2Base::markDirty(int16_t x, int16_t y, uint8_t w, uint8_t h)
+{
+ #ifdef ARDUBOY_DIRTY_RECT
+  int16_t xEnd = x + w - 1; // last x point
+  int16_t yEnd = y + h - 1; // last y point
+
+  // Check if the area is not on the display
+  if (w == 0 || h == 0 || xEnd < 0 || x >= WIDTH || yEnd < 0 || y >= HEIGHT)
+    return;
+
+  // clip to the display edges
+  if (x < 0)
+    x = 0;
+  if (xEnd > WIDTH - 1)
+    xEnd = WIDTH - 1;
+  if (y < 0)
+    y = 0;
+  if (yEnd > HEIGHT - 1)
+    yEnd = HEIGHT - 1;
+
+  for (uint8_t page = y / 8; page <= yEnd / 8; page++)
+  {
+    markDirtySpan(page, x, xEnd);
+  }
+ #endif
+}
+
+#if !(defined(GU12864_800B) || defined(OLED_96X96) || defined(OLED_128X96) || defined(OLED_128X128) || defined(OLED_128X64_ON_96X96) || defined(OLED_128X64_ON_128X96) || defined(OLED_128X64_ON_128X128) || defined(OLED_128X96_ON_128X128) || defined(OLED_96X96_ON_128X128) || defined(OLED_64X128_ON_128X128))
+void Arduboy2Base::setScroll(uint8_t x, uint8_t y)
+{
+  scrollX = x % WIDTH;
+  scrollY = y % HEIGHT;
+}
+
+void Arduboy2Base::scrollBy(int8_t dx, int8_t dy)
+{
+  scrollX = (scrollX + dx + WIDTH * 2) % WIDTH;
+  scrollY = (scrollY + dy + HEIGHT * 2) % HEIGHT;
+}
+
+uint8_t Arduboy2Base::getScrollX()
+{
+  return scrollX;
+}
+
+uint8_t Arduboy2Base::getScrollY()
+{
+  return scrollY;
+}
+
+uint8_t Arduboy2Base::scrollBufferX(int16_t x)
+{
+  return (x % WIDTH + WIDTH + scrollX) % WIDTH;
+}
+
+uint8_t Arduboy2Base::scrollBufferY(int16_t y)
+{
+  return (y % HEIGHT + HEIGHT + scrollY) % HEIGHT;
+}
+
+void Arduboy2Base::displayScroll(bool clear)
+{
+ #ifdef ARDUBOY_DISPLAY_SYNC
+  parkDisplay();
+ #endif
+  setStartLine(scrollY);
+  paintScreenPages(sBuffer, 0, HEIGHT / 8, scrollX);
+ #ifdef ARDUBOY_DISPLAY_SYNC
+  unparkDisplay();
+ #endif
+  if (clear)
+  {
+    fillScreen(BLACK);
+  }
+}
+
+void Arduboy2Base::displayScrollRows(int16_t y, uint8_t h)
+{
+  int16_t yEnd = y + h;
+
+  // clip to the screen
+  if (y < 0)
+  {
+    y = 0;
+  }
+  if (yEnd > HEIGHT)
+  {
+    yEnd = HEIGHT;
+  }
+
+ #ifdef ARDUBOY_DISPLAY_SYNC
+  parkDisplay();
+ #endif
+  setStartLine(scrollY);
+  if (y < yEnd)
+  {
+    // buffer rows to send, may wrap around to the top of the buffer
+    uint8_t row = (y + scrollY) % HEIGHT;
+    uint8_t page = row >> 3;
+    uint16_t last = row + (yEnd - y) - 1;
+    if (last < HEIGHT)
+    {
+      paintScreenPages(sBuffer, page, (last >> 3) - page + 1, scrollX);
+    }
+    else
+    {
+      uint8_t wrapPages = ((last - HEIGHT) >> 3) + 1;
+      if (wrapPages > page)
+      {
+        wrapPages = page; // the remaining pages already cover the rest
+      }
+      paintScreenPages(sBuffer, page, HEIGHT / 8 - page, scrollX);
+      if (wrapPages)
+      {
+        paintScreenPages(sBuffer, 0, wrapPages, scrollX);
+      }
+    }
+  }
+ #ifdef ARDUBOY_DISPLAY_SYNC
+  unparkDisplay();
+ #endif
+}
+#endif
+
+void Arduboy2Base::displayGray()
+{
+  // the buffer is kept after the first refresh of the high bit plane,
+  // so it is shown again without being redrawn. With ARDUBOY_DISPLAY_SYNC
+  // display() parks the display while the plane is sent, so each plane
+  // starts a new refresh
+  display(grayPhase != 0);
+  if (++grayPhase > 2)
+  {
+    grayPhase = 0;
+  }
 }
 
+uint8_t Arduboy2Base::shadeColor(uint8_t shade)
+{
+  return (shade >> grayPlane()) & 1;
+}
+
+uint8_t Arduboy2Base::grayPlane()
+{
+  return grayPhase == 2 ? 0 : 1;
+}
+
+bool Arduboy2Base::grayRenderNeeded()
+{
+  return grayPhase != 1;
+}
+
+#ifdef ARDUBOY_GRAY4
+void Arduboy2Base::displayGray4(void (*render)())
+{
+  fillScreenGray4(0);
+  for (gray4Left = 0; gray4Left < WIDTH; gray4Left += GRAY4_STRIP_WIDTH)
+  {
+    render();
+    paintScreenGray4(sBuffer, true);
+  }
+  gray4Left = 0;
+}
+
+int16_t Arduboy2Base::getGray4StripX()
+{
+  return gray4Left;
+}
+
+void Arduboy2Base::drawPixelGray4(int16_t x, int16_t y, uint8_t level)
+{
+  if (x < gray4Left || x >= gray4Left + GRAY4_STRIP_WIDTH ||
+      y < 0 || y >= HEIGHT)
+  {
+    return;
+  }
+
+  uint8_t* ptr = gray4Column(x) + y;
+  if (x & 1)
+  {
+    *ptr = (*ptr & 0xF0) | (level & 0x0F);
+  }
+  else
+  {
+    *ptr = (*ptr & 0x0F) | (level << 4);
+  }
+}
+
+uint8_t Arduboy2Base::getPixelGray4(int16_t x, int16_t y)
+{
+  if (x < gray4Left || x >= gray4Left + GRAY4_STRIP_WIDTH ||
+      y < 0 || y >= HEIGHT)
+  {
+    return 0;
+  }
+
+  uint8_t b = gray4Column(x)[y];
+  return (x & 1) ? b & 0x0F : b >> 4;
+}
+
+void Arduboy2Base::fillRectGray4(int16_t x, int16_t y, uint8_t w, uint8_t h, uint8_t level)
+{
+  int16_t xEnd = x + w;
+  int16_t yEnd = y + h;
+
+  // clip to the current strip
+  if (x < gray4Left)
+  {
+    x = gray4Left;
+  }
+  if (xEnd > gray4Left + GRAY4_STRIP_WIDTH)
+  {
+    xEnd = gray4Left + GRAY4_STRIP_WIDTH;
+  }
+  if (y < 0)
+  {
+    y = 0;
+  }
+  if (yEnd > HEIGHT)
+  {
+    yEnd = HEIGHT;
+  }
+  if (x >= xEnd || y >= yEnd)
+  {
+    return;
+  }
+
+  uint8_t rows = yEnd - y;
+  level = (level & 0x0F) * 0x11;
+  while (x < xEnd)
+  {
+    uint8_t* ptr = gray4Column(x) + y;
+    uint8_t mask;
+    // fill both pixels of a column pair at once when possible
+    if (!(x & 1) && (x + 1 < xEnd))
+    {
+      mask = 0xFF;
+      x += 2;
+    }
+    else
+    {
+      mask = (x & 1) ? 0x0F : 0xF0;
+      x++;
+    }
+    uint8_t bits = level & mask;
+    for (uint8_t i = rows; i > 0; i--)
+    {
+      *ptr = (*ptr & ~mask) | bits;
+      ptr++;
+    }
+  }
+}
+
+void Arduboy2Base::fillScreenGray4(uint8_t level)
+{
+  memset(sBuffer, (level & 0x0F) * 0x11, (HEIGHT * WIDTH) / 8);
+}
+
+void Arduboy2Base::drawBitmapGray4(int16_t x, int16_t y, const uint8_t *bitmap,
+                                   uint8_t w, uint8_t h, uint8_t level)
+{
+  int16_t stripEnd = gray4Left + GRAY4_STRIP_WIDTH;
+  // no need to draw at all if we're offscreen
+  if (x + w <= gray4Left || x >= stripEnd || y + h <= 0 || y >= HEIGHT)
+    return;
+
+  level = (level & 0x0F) * 0x11;
+  uint8_t i = (x < gray4Left) ? gray4Left - x : 0;
+  for (; i < w && x + i < stripEnd; i++)
+  {
+    int16_t px = x + i;
+    uint8_t mask = (px & 1) ? 0x0F : 0xF0;
+    uint8_t bits = level & mask;
+    uint8_t* column = gray4Column(px);
+    const uint8_t* src = bitmap + i;
+    uint8_t b = 0;
+    for (uint8_t j = 0; j < h; j++)
+    {
+      if ((j & 7) == 0)
+      {
+        b = pgm_read_byte(src);
+        src += w;
+      }
+      int16_t py = y + j;
+      if ((b & 1) && py >= 0 && py < HEIGHT)
+      {
+        column[py] = (column[py] & ~mask) | bits;
+      }
+      b >>= 1;
+    }
+  }
+}
+
+void Arduboy2Base::drawImageGray4(int16_t x, int16_t y, const uint8_t *image)
+{
+  uint8_t w = pgm_read_byte(image++);
+  uint8_t h = pgm_read_byte(image++);
+  int16_t stripEnd = gray4Left + GRAY4_STRIP_WIDTH;
+  // no need to draw at all if we're offscreen
+  if (x + w <= gray4Left || x >= stripEnd || y + h <= 0 || y >= HEIGHT)
+    return;
+
+  // rows of the image that are on screen
+  uint8_t top = (y < 0) ? -y : 0;
+  uint8_t rows = ((y + h > HEIGHT) ? HEIGHT - y : h) - top;
+
+  for (uint8_t i = 0; i < w; i += 2)
+  {
+    int16_t px = x + i;
+    if (px + 1 < gray4Left)
+    {
+      continue;
+    }
+    if (px >= stripEnd)
+    {
+      break;
+    }
+    const uint8_t* src = image + (i >> 1) * h + top;
+    if (!(px & 1) && px >= gray4Left && i + 1 < w)
+    {
+      // column pair lines up with the buffer
+      memcpy_P(gray4Column(px) + y + top, src, rows);
+      continue;
+    }
+    for (uint8_t k = 0; k < 2 && i + k < w; k++)
+    {
+      int16_t qx = px + k;
+      if (qx < gray4Left || qx >= stripEnd)
+      {
+        continue;
+      }
+      uint8_t* dst = gray4Column(qx) + y + top;
+      for (uint8_t j = 0; j < rows; j++)
+      {
+        uint8_t level = pgm_read_byte(src + j);
+        level = k ? level & 0x0F : level >> 4;
+        if (qx & 1)
+        {
+          dst[j] = (dst[j] & 0xF0) | level;
+        }
+        else
+        {
+          dst[j] = (dst[j] & 0x0F) | (level << 4);
+        }
+      }
+    }
+  }
+}
+#endif
+
+#ifdef ARDUBOY_DIRTY_RECT
+void Arduboy2Base::resetDirtySpans(bool clear)
+{
+  for (uint8_t page = 0; page < HEIGHT / 8; page++)
+  {
+    // an empty span has start > end
+    if (clear)
+    {
+      // the areas that were drawn to have been cleared in the buffer but
+      // still show on the display, so they have to be painted again
+      dirtySpans[page] = drawnSpans[page];
+      drawnSpans[page].start = 0xFF;
+      drawnSpans[page].end = 0;
+    }
+    else
+    {
+      dirtySpans[page].start = 0xFF;
+      dirtySpans[page].end = 0;
+    }
+  }
+}
+#endif
+
 uint8_t* Arduboy2Base::getBuffer()
 {
   return sBuffer;
@@ -1077,6 +1917,105 @@ bool Arduboy2Base::collide(Rect rect1, Rect rect2)
            rect2.y + rect2.height <= rect1.y);
 }
 
+// The mask of a sprite frame for collideMasks()
+struct CollisionMask
+{
+  const uint8_t *data; // first mask byte of the frame
+  uint8_t width;
+  uint8_t height;
+  uint8_t pages;       // height in 8 pixel pages
+  uint8_t step;        // 2 if mask bytes alternate with image bytes, else 1
+};
+
+static void getCollisionMask(const uint8_t *bitmap, const uint8_t *mask,
+                             uint8_t frame, CollisionMask& m)
+{
+  m.width = pgm_read_byte(bitmap);
+  m.height = pgm_read_byte(bitmap + 1);
+  m.pages = (m.height + 7) / 8;
+  uint16_t frameSize = m.width * m.pages;
+
+  if (mask == NULL) {
+    // image and mask bytes alternate, the mask follows its image byte
+    m.step = 2;
+    m.data = bitmap + 2 + frame * frameSize * 2 + 1;
+  }
+  else {
+    m.step = 1;
+    m.data = mask + frame * frameSize;
+  }
+}
+
+bool Arduboy2Base::collideMasks(int16_t x1, int16_t y1, const uint8_t *bitmap1,
+                                const uint8_t *mask1, uint8_t frame1,
+                                int16_t x2, int16_t y2, const uint8_t *bitmap2,
+                                const uint8_t *mask2, uint8_t frame2)
+{
+  CollisionMask m1, m2;
+
+  getCollisionMask(bitmap1, mask1, frame1, m1);
+  getCollisionMask(bitmap2, mask2, frame2, m2);
+
+  // the intersection of the rectangles, relative to the first sprite
+  int16_t left = max(x1, x2) - x1;
+  int16_t right = min(x1 + m1.width, x2 + m2.width) - x1;
+  int16_t top = max(y1, y2) - y1;
+  int16_t bottom = min(y1 + m1.height, y2 + m2.height) - y1;
+
+  if (left >= right || top >= bottom) {
+    return false;
+  }
+
+  uint8_t columns = right - left;
+  int16_t dx = x1 - x2; // add to a column of the first to get the second
+  int16_t dy = y1 - y2; // add to a row of the first to get the second
+
+  for (uint8_t page = top / 8; page <= (bottom - 1) / 8; page++) {
+    // only test the rows inside the intersection
+    int16_t row = page * 8;
+    uint8_t rowMask = 0xFF;
+    if (row < top) {
+      rowMask <<= top - row;
+    }
+    if (row + 8 > bottom) {
+      rowMask &= 0xFF >> (row + 8 - bottom);
+    }
+
+    // the 8 rows of the second mask level with this page start at row2.
+    // They are taken from the pages above and below it, if they exist.
+    int16_t row2 = row + dy;
+    int8_t page2 = row2 >> 3;
+    uint8_t shift = row2 & 7;
+    const uint8_t *upper = NULL;
+    const uint8_t *lower = NULL;
+    if (page2 >= 0 && page2 < m2.pages) {
+      upper = m2.data + (page2 * m2.width + left + dx) * m2.step;
+    }
+    if (shift != 0 && page2 + 1 >= 0 && page2 + 1 < m2.pages) {
+      lower = m2.data + ((page2 + 1) * m2.width + left + dx) * m2.step;
+    }
+    if (upper == NULL && lower == NULL) {
+      continue;
+    }
+
+    const uint8_t *data1 = m1.data + (page * m1.width + left) * m1.step;
+
+    for (uint8_t i = 0; i < columns; i++) {
+      uint16_t column2 = 0;
+      if (upper != NULL) {
+        column2 = pgm_read_byte(upper + i * m2.step);
+      }
+      if (lower != NULL) {
+        column2 |= pgm_read_byte(lower + i * m2.step) << 8;
+      }
+      if (pgm_read_byte(data1 + i * m1.step) & rowMask & (uint8_t)(column2 >> shift)) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
 uint16_t Arduboy2Base::readUnitID()
 {
   return EEPROM.read(eepromUnitID) |
@@ -1306,7 +2245,6 @@ size_t Arduboy2::write(uint8_t c)
 void Arduboy2::drawChar
   (int16_t x, int16_t y, unsigned char c, uint8_t color, uint8_t bg, uint8_t size)
 {
-  uint8_t line;
   bool draw_background = bg != color;
   const uint8_t* bitmap = font5x7 + c * 5;
 
@@ -1319,25 +2257,86 @@ void Arduboy2::drawChar
     return;
   }
 
-  for (uint8_t i = 0; i < 6; i++ )
+  // Pixels of the character are drawn in the foreground color and the
+  // others in the background color. Each is skipped if it's BLACK, unless
+  // the two colors differ.
+  uint8_t fgDrawn = (color || draw_background) ? 0xFF : 0;
+  uint8_t bgDrawn = (bg || draw_background) ? 0xFF : 0;
+  uint8_t fgWhite = (color & 1) ? fgDrawn : 0;
+  uint8_t bgWhite = (bg & 1) ? bgDrawn : 0;
+
+  if (size == 1)
   {
-    line = pgm_read_byte(bitmap++);
-    if (i == 5) {
-      line = 0x0;
+   #ifdef ARDUBOY_DIRTY_RECT
+    markDirty(x, y, 6, 8);
+   #endif
+
+    // Each column of the character is written into one page, or two
+    // pages if y isn't a multiple of 8, as a byte mask of the pixels to
+    // change and the new pixel values.
+    int8_t page = y >> 3;
+    uint8_t yOffset = y & 7;
+    uint8_t* pBuf = sBuffer + (page * WIDTH) + x;
+
+    for (uint8_t i = 0; i < 6; i++, pBuf++)
+    {
+      uint8_t line = (i < 5) ? pgm_read_byte(bitmap++) : 0;
+
+      if ((uint16_t)(x + i) >= WIDTH) // also skips negative x
+        continue;
+
+      uint8_t drawn = (line & fgDrawn) | (~line & bgDrawn);
+      uint8_t white = (line & fgWhite) | (~line & bgWhite);
+
+      if (yOffset == 0)
+      {
+        *pBuf = (*pBuf & ~drawn) | white;
+        continue;
+      }
+
+      uint16_t drawnShifted = drawn << yOffset;
+      uint16_t whiteShifted = white << yOffset;
+
+      if (page >= 0)
+      {
+        *pBuf = (*pBuf & ~(uint8_t)drawnShifted) | (uint8_t)whiteShifted;
+      }
+      if (page < HEIGHT / 8 - 1)
+      {
+        pBuf[WIDTH] = (pBuf[WIDTH] & ~(uint8_t)(drawnShifted >> 8)) |
+                      (uint8_t)(whiteShifted >> 8);
+      }
     }
+    return;
+  }
 
-    for (uint8_t j = 0; j < 8; j++)
+  // Scaled characters are drawn as runs of equally colored pixels down
+  // each column, filled a byte at a time by fillRect().
+  for (uint8_t i = 0; i < 6; i++)
+  {
+    uint8_t line = (i < 5) ? pgm_read_byte(bitmap++) : 0;
+    uint8_t drawn = (line & fgDrawn) | (~line & bgDrawn);
+    uint8_t white = (line & fgWhite) | (~line & bgWhite);
+    uint8_t j = 0;
+
+    while (j < 8)
     {
-      uint8_t draw_color = (line & 0x1) ? color : bg;
+      uint8_t start = j;
+      bool runDrawn = drawn & 1;
+      uint8_t runColor = white & 1;
 
-      if (draw_color || draw_background) {
-        for (uint8_t a = 0; a < size; a++ ) {
-          for (uint8_t b = 0; b < size; b++ ) {
-            drawPixel(x + (i * size) + a, y + (j * size) + b, draw_color);
-          }
-        }
+      do
+      {
+        drawn >>= 1;
+        white >>= 1;
+        j++;
+      } while ((j < 8) && ((drawn & 1) == runDrawn) && ((white & 1) == runColor));
+
+      if (runDrawn)
+      {
+        fillRect(x + (i * size), y + (start * size), size, (j - start) * size,
+                 runColor);
       }
-      line >>= 1;
     }
   }
 }
@@ -78,6 +78,11 @@
 // Pixels that would exceed the display limits will be ignored.
 #define PIXEL_SAFE_MODE
 
+// If defined, the drawing functions keep track of the areas of the screen
+// buffer that have been changed, so displayDirty() only has to send those
+// areas to the display. It can also be defined using a -D compiler option.
+//#define ARDUBOY_DIRTY_RECT
+
 // pixel colors
 #define BLACK 0  /**< Color value for an unlit pixel for draw functions. */
 #define WHITE 1  /**< Color value for a lit pixel for draw functions. */
@@ -88,12 +93,20 @@
  * BLACK pixels will become WHITE and WHITE will become BLACK.
  *
  * \note
- * Only function Arduboy2Base::drawBitmap() currently supports this value.
+ * Only functions Arduboy2Base::drawBitmap(), Arduboy2Base::drawLine(),
+ * Arduboy2Base::fillRect() and the functions that use it, such as
+ * Arduboy2Base::drawFastVLine(), currently support this value.
  */
 #define INVERT 2
 
 #define CLEAR_BUFFER true /**< Value to be passed to `display()` to clear the screen buffer. */
 
+// shades for the grayscale functions
+#define SHADE_BLACK 0      /**< Shade value for an unlit pixel, for `shadeColor()`. */
+#define SHADE_DARK_GRAY 1  /**< Shade value for a 1/3 lit pixel, for `shadeColor()`. */
+#define SHADE_LIGHT_GRAY 2 /**< Shade value for a 2/3 lit pixel, for `shadeColor()`. */
+#define SHADE_WHITE 3      /**< Shade value for a fully lit pixel, for `shadeColor()`. */
+
 
 //=============================================
 //========== Rect (rectangle) object ==========
@@ -476,10 +489,426 @@ class Arduboy2Base : public Arduboy2Core
    * Using `display(CLEAR_BUFFER)` is faster and produces less code than
    * calling `display()` followed by `clear()`.
    *
-   * \see display() clear()
+   * If `ARDUBOY_BACKGROUND_DISPLAY` and `ARDUBOY_I2C_TWI` are defined, both
+   * forms of `display()` return after copying the buffer and the display is updated in the
+   * background. See `paintScreenBackground()`.
+   *
+   * \see display() clear() displayBusy()
    */
   void display(bool clear);
 
+  /** \brief
+   * Copy only the changed areas of the display buffer to the display.
+   * The display buffer can optionally be cleared.
+   *
+   * \param clear If `true` the display buffer will be cleared to zero.
+   * The defined value `CLEAR_BUFFER` should be used instead of `true` to make
+   * it more meaningful. (optional; defaults to `false`)
+   *
+   * \details
+   * This function requires `ARDUBOY_DIRTY_RECT` to be defined. The drawing
+   * functions then keep track of the range of columns that have changed in
+   * each page (row of 8 pixels high) of the display buffer. Only these
+   * ranges are written to the display, using `paintScreenSpan()`. On menu
+   * screens and games that only change small parts of the screen each
+   * frame, this takes a lot less time than `display()`. The gain is largest
+   * on the I2C displays.
+   *
+   * If `clear` is `true`, only the areas that have been drawn to are
+   * cleared and these areas will be sent to the display on the next call,
+   * so the previous frame is erased properly.
+   *
+   * If `ARDUBOY_DIRTY_RECT` isn't defined, or a 4 bit per pixel display is
+   * used, this function is the same as `display(clear)`.
+   *
+   * \note
+   * Functions that write to `sBuffer` directly, instead of using the drawing
+   * functions of this library or the `Sprites` classes, have to call
+   * `markDirty()` for the area they change.
+   *
+   * \see display(bool) markDirty() paintScreenSpan()
+   */
+  void displayDirty(bool clear = false);
+
+  /** \brief
+   * Mark an area of the display buffer as changed.
+   *
+   * \param x The X coordinate of the left edge of the area.
+   * \param y The Y coordinate of the top edge of the area.
+   * \param w The width of the area.
+   * \param h The height of the area.
+   *
+   * \details
+   * The area will be written to the display on the next call to
+   * `displayDirty()`. Parts of the area that are outside the screen are
+   * ignored. The drawing functions of this library and the `Sprites` classes
+   * call this function themselves.
+   *
+   * This function does nothing if `ARDUBOY_DIRTY_RECT` isn't defined.
+   *
+   * \see displayDirty()
+   */
+  static void markDirty(int16_t x, int16_t y, uint8_t w, uint8_t h);
+
+#if !(defined(GU12864_800B) || defined(OLED_96X96) || defined(OLED_128X96) || defined(OLED_128X128) || defined(OLED_128X64_ON_96X96) || defined(OLED_128X64_ON_128X96) || defined(OLED_128X64_ON_128X128) || defined(OLED_128X96_ON_128X128) || defined(OLED_96X96_ON_128X128) || defined(OLED_64X128_ON_128X128))
+  /** \brief
+   * Set the scroll position of the screen buffer.
+   *
+   * \param x The column of the screen buffer shown at the left edge of the
+   * screen.
+   * \param y The row of the screen buffer shown at the top of the screen.
+   *
+   * \details
+   * With scrolling, the screen buffer is treated as a ring: the columns left
+   * of `x` are shown at the right edge of the screen and the rows above `y`
+   * at the bottom. To scroll, the sketch changes the scroll position and
+   * only draws the columns or rows that have become visible, at the buffer
+   * location given by `scrollBufferX()` or `scrollBufferY()`. The rest of
+   * the screen buffer doesn't have to be redrawn.
+   *
+   * The new position is used by the next call to `displayScroll()` or
+   * `displayScrollRows()`. `display()` and `displayDirty()` always show the
+   * screen buffer unscrolled.
+   *
+   * \note
+   * Scrolling isn't available for the 4 bit per pixel displays and the
+   * GU12864.
+   *
+   * \see scrollBy() displayScroll() displayScrollRows() scrollBufferX()
+   * scrollBufferY()
+   */
+  static void setScroll(uint8_t x, uint8_t y);
+
+  /** \brief
+   * Change the scroll position of the screen buffer.
+   *
+   * \param dx The number of columns to scroll to the right. A negative value
+   * scrolls to the left.
+   * \param dy The number of rows to scroll down. A negative value scrolls
+   * up.
+   *
+   * \see setScroll()
+   */
+  static void scrollBy(int8_t dx, int8_t dy);
+
+  /** \brief
+   * Get the column of the screen buffer shown at the left edge of the screen.
+   *
+   * \see setScroll()
+   */
+  static uint8_t getScrollX();
+
+  /** \brief
+   * Get the row of the screen buffer shown at the top of the screen.
+   *
+   * \see setScroll()
+   */
+  static uint8_t getScrollY();
+
+  /** \brief
+   * Get the screen buffer column that is shown at a screen X coordinate.
+   *
+   * \param x The X coordinate on the screen.
+   *
+   * \return The column in the screen buffer, from 0 to `WIDTH - 1`.
+   *
+   * \details
+   * Drawing at this column draws at the given location on the screen, using
+   * the current scroll position. Something drawn across the right edge of
+   * the screen buffer has to be drawn a second time, `WIDTH` pixels to the
+   * left, to show the part that wraps around.
+   *
+   * \see setScroll() scrollBufferY()
+   */
+  static uint8_t scrollBufferX(int16_t x);
+
+  /** \brief
+   * Get the screen buffer row that is shown at a screen Y coordinate.
+   *
+   * \param y The Y coordinate on the screen.
+   *
+   * \return The row in the screen buffer, from 0 to `HEIGHT - 1`.
+   *
+   * \see setScroll() scrollBufferX()
+   */
+  static uint8_t scrollBufferY(int16_t y);
+
+  /** \brief
+   * Copy the contents of the screen buffer to the screen, using the scroll
+   * position.
+   *
+   * \param clear If `true` the display buffer will be cleared to zero.
+   * (optional; defaults to `false`)
+   *
+   * \details
+   * The vertical scroll position is set with the display's start line
+   * command, so vertical scrolling costs nothing. For horizontal scrolling
+   * the columns of each page are sent in rotated order. The whole buffer is
+   * sent, so use this function after scrolling horizontally.
+   *
+   * The start line stays set until `display()` or `displayDirty()` sets it
+   * back to 0.
+   *
+   * \see setScroll() displayScrollRows() Arduboy2Core::paintScreenPages()
+   */
+  void displayScroll(bool clear = false);
+
+  /** \brief
+   * Scroll the screen and copy only some rows of the screen buffer to the
+   * screen.
+   *
+   * \param y The Y coordinate on the screen of the first row to copy.
+   * \param h The number of rows to copy.
+   *
+   * \details
+   * The display's start line is set to the vertical scroll position, then
+   * only the pages of the screen buffer that hold the given screen rows are
+   * sent. After scrolling down by a few rows, only the rows that have become
+   * visible at the bottom of the screen have to be sent, which takes a
+   * fraction of the time of `display()`. Any other changes to the buffer,
+   * such as moving sprites, have to be included in the rows sent, or sent
+   * with further calls.
+   *
+   * If `h` is 0 the screen is only scrolled.
+   *
+   * \see setScroll() displayScroll()
+   */
+  void displayScrollRows(int16_t y, uint8_t h);
+#endif
+
+  /** \brief
+   * Display the next bit plane of a 4 shade grayscale image.
+   *
+   * \details
+   * A grayscale image is made of two bit planes. The high bit plane is
+   * shown for two display refreshes and the low bit plane for one, so a
+   * pixel is lit for 0, 1, 2 or 3 out of every 3 refreshes, giving the
+   * shades `SHADE_BLACK`, `SHADE_DARK_GRAY`, `SHADE_LIGHT_GRAY` and
+   * `SHADE_WHITE`.
+   *
+   * The planes are drawn one at a time in the normal screen buffer, so no
+   * extra RAM is needed. Before each call to this function, if
+   * `grayRenderNeeded()` returns `true`, the sketch draws the whole image
+   * using `shadeColor()` to get the color to draw each shade with. When the
+   * high bit plane is shown for the second time the buffer is kept, so the
+   * image is drawn 2 times for every 3 refreshes.
+   *
+   * This function should be called at a fixed rate, 3 times the desired
+   * grayscale frame rate, by setting the frame rate with `setFrameRate()`
+   * and calling it once for every `nextFrame()`.
+   *
+   * `ARDUBOY_DISPLAY_SYNC` must be defined for stable shades. Each bit plane
+   * is then sent while the display is parked and the row scan restarts from
+   * the top afterwards, so every plane is shown for the same number of
+   * display refreshes. `setFrameRate()` sets the display clock so that whole
+   * refreshes fit into a frame, which with the typical oscillator frequency
+   * allows frame rates up to about 90 (30 grayscale images per second).
+   * Without `ARDUBOY_DISPLAY_SYNC` the display refreshes at its own rate,
+   * which drifts against the timer used by `nextFrame()`, so the shades beat
+   * and parts of the screen can show the wrong plane.
+   *
+   * \code{.cpp}
+   * void loop() {
+   *   if (!arduboy.nextFrame()) return;
+   *   if (arduboy.grayPlane() == 1 && arduboy.grayRenderNeeded()) {
+   *     // update the game once per grayscale image
+   *   }
+   *   if (arduboy.grayRenderNeeded()) {
+   *     arduboy.fillRect(0, 0, 32, 32, arduboy.shadeColor(SHADE_DARK_GRAY));
+   *     Sprites::drawShaded(40, 8, player, 0, SHADE_LIGHT_GRAY);
+   *   }
+   *   arduboy.displayGray();
+   * }
+   * \endcode
+   *
+   * \see shadeColor() grayRenderNeeded() grayPlane() Sprites::drawShaded()
+   * Sprites::drawGray()
+   */
+  void displayGray();
+
+  /** \brief
+   * Get the color to draw a shade with, for the bit plane being drawn.
+   *
+   * \param shade The shade value: `SHADE_BLACK`, `SHADE_DARK_GRAY`,
+   * `SHADE_LIGHT_GRAY` or `SHADE_WHITE`.
+   *
+   * \return `WHITE` if the shade has a pixel lit in the bit plane that is
+   * being drawn, otherwise `BLACK`.
+   *
+   * \details
+   * The returned value can be passed as the color of any drawing function,
+   * so every drawing function can be used to draw shades.
+   *
+   * \see displayGray() grayPlane()
+   */
+  static uint8_t shadeColor(uint8_t shade);
+
+  /** \brief
+   * Get the bit plane of the grayscale image that is being drawn.
+   *
+   * \return 1 for the high bit plane, 0 for the low bit plane.
+   *
+   * \see displayGray() shadeColor()
+   */
+  static uint8_t grayPlane();
+
+  /** \brief
+   * Test if the screen buffer has to be drawn before calling `displayGray()`.
+   *
+   * \return `true` if a bit plane has to be drawn. `false` if the buffer
+   * still holds the plane that will be displayed next.
+   *
+   * \see displayGray()
+   */
+  static bool grayRenderNeeded();
+
+#ifdef ARDUBOY_GRAY4
+  /** \brief
+   * Render and display a 16 level grayscale screen on a 4 bit per pixel
+   * display.
+   *
+   * \param render A function that draws the screen using the `Gray4`
+   * drawing functions.
+   *
+   * \details
+   * This function is only available if `ARDUBOY_GRAY4` is defined and a
+   * 96x96, 128x96 or 128x128 display is used. A full screen of 4 bit pixels
+   * needs 4 times the RAM of the screen buffer, which is more than the
+   * processor has. Instead, the screen buffer is used to hold one vertical
+   * strip of the screen, `GRAY4_STRIP_WIDTH` pixels wide, at a time.
+   *
+   * The buffer is cleared and the render function is called once for each
+   * of the `GRAY4_STRIPS` strips, from left to right. The `Gray4` drawing
+   * functions only draw the part of the image that is inside the current
+   * strip, so the render function simply draws the whole screen each time.
+   * After each call the strip is sent to the display by
+   * `paintScreenGray4()`.
+   *
+   * No extra RAM is used. The display transfer takes the same time as
+   * `display()` on these displays, about 18 CPU cycles for every 2 pixels.
+   * The render function is called `GRAY4_STRIPS` times per screen, but each
+   * call only writes the pixels of its own strip. Use `getGray4StripX()` to
+   * skip drawing objects that are outside of the strip.
+   *
+   * The other drawing functions, including `Sprites`, draw 1 bit pixels and
+   * must not be used while rendering a grayscale screen.
+   *
+   * \code{.cpp}
+   * void render() {
+   *   arduboy.fillRectGray4(0, 0, WIDTH, HEIGHT / 2, 3);
+   *   arduboy.drawBitmapGray4(x, y, player, 16, 16, 15);
+   * }
+   *
+   * void loop() {
+   *   if (!arduboy.nextFrame()) return;
+   *   arduboy.displayGray4(render);
+   * }
+   * \endcode
+   *
+   * \see paintScreenGray4() drawPixelGray4() fillRectGray4()
+   * drawBitmapGray4() drawImageGray4()
+   */
+  void displayGray4(void (*render)());
+
+  /** \brief
+   * Get the X coordinate of the left edge of the strip being rendered.
+   *
+   * \return The X coordinate of the first column of the current strip.
+   *
+   * \details
+   * The strip is `GRAY4_STRIP_WIDTH` pixels wide.
+   *
+   * \see displayGray4()
+   */
+  static int16_t getGray4StripX();
+
+  /** \brief
+   * Set a single pixel in the grayscale strip buffer to a gray level.
+   *
+   * \param x The X coordinate of the pixel.
+   * \param y The Y coordinate of the pixel.
+   * \param level The gray level, from 0 (black) to 15 (white).
+   *
+   * \see displayGray4() getPixelGray4()
+   */
+  static void drawPixelGray4(int16_t x, int16_t y, uint8_t level);
+
+  /** \brief
+   * Get the gray level of a pixel in the grayscale strip buffer.
+   *
+   * \param x The X coordinate of the pixel.
+   * \param y The Y coordinate of the pixel.
+   *
+   * \return The gray level of the pixel, from 0 to 15. 0 is returned for
+   * pixels outside of the current strip.
+   *
+   * \see displayGray4() drawPixelGray4()
+   */
+  static uint8_t getPixelGray4(int16_t x, int16_t y);
+
+  /** \brief
+   * Draw a filled-in rectangle in a gray level.
+   *
+   * \param x The X coordinate of the upper left corner.
+   * \param y The Y coordinate of the upper left corner.
+   * \param w The width of the rectangle.
+   * \param h The height of the rectangle.
+   * \param level The gray level, from 0 (black) to 15 (white).
+   *
+   * \see displayGray4() fillScreenGray4()
+   */
+  static void fillRectGray4(int16_t x, int16_t y, uint8_t w, uint8_t h, uint8_t level);
+
+  /** \brief
+   * Fill the grayscale strip buffer with a gray level.
+   *
+   * \param level The gray level, from 0 (black) to 15 (white).
+   *
+   * \see displayGray4() fillRectGray4()
+   */
+  static void fillScreenGray4(uint8_t level);
+
+  /** \brief
+   * Draw a bitmap from program memory in a gray level.
+   *
+   * \param x The X coordinate of the top left pixel affected by the bitmap.
+   * \param y The Y coordinate of the top left pixel affected by the bitmap.
+   * \param bitmap A pointer to the bitmap array in program memory.
+   * \param w The width of the bitmap in pixels.
+   * \param h The height of the bitmap in pixels.
+   * \param level The gray level, from 0 (black) to 15 (white).
+   *
+   * \details
+   * The bitmap has the same format as for `drawBitmap()`. Bits set to 1 are
+   * drawn in the given gray level. Bits set to 0 leave the buffer unchanged.
+   *
+   * \see displayGray4() drawImageGray4() drawBitmap()
+   */
+  static void drawBitmapGray4(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t w, uint8_t h, uint8_t level);
+
+  /** \brief
+   * Draw a 4 bit per pixel image from program memory.
+   *
+   * \param x The X coordinate of the top left pixel affected by the image.
+   * \param y The Y coordinate of the top left pixel affected by the image.
+   * \param image A pointer to the image array in program memory.
+   *
+   * \details
+   * The first two bytes of the array are the width and height of the image
+   * in pixels. They are followed by the pixels in the format used by the
+   * display: one byte for each two horizontally adjacent pixels, the left
+   * one in the high nibble, with the bytes for each pair of columns
+   * following each other from top to bottom. For an odd width the low
+   * nibbles of the last column pair are ignored.
+   *
+   * All pixels of the image replace the contents of the buffer. If `x` is
+   * even, whole column pairs are copied directly from program memory.
+   *
+   * \see displayGray4() drawBitmapGray4() paintScreenGray4()
+   */
+  static void drawImageGray4(int16_t x, int16_t y, const uint8_t *image);
+#endif
+
   /** \brief
    * Set a single pixel in the display buffer to the specified color.
    *
@@ -535,6 +964,12 @@ class Arduboy2Base : public Arduboy2Core
    * Draw a line from the start point to the end point using
    * Bresenham's algorithm.
    * The start and end points can be at any location with respect to the other.
+   *
+   * The line is clipped to the screen first, so the time taken only depends
+   * on the part of the line that's visible. The pixels drawn are the same as
+   * if the whole line had been drawn.
+   *
+   * The color can also be `INVERT`.
    */
   void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint8_t color = WHITE);
 
@@ -775,7 +1210,13 @@ class Arduboy2Base : public Arduboy2Core
    * to 16ms, giving an actual frame rate of 62.5 FPS.
    * \endparblock
    *
-   * \see nextFrame() setFrameDuration()
+   * If `ARDUBOY_DISPLAY_SYNC` is defined, the display clock is also set so
+   * the display refreshes a whole number of times per frame. Calling
+   * `display()` once for every `nextFrame()` then gives each frame the same
+   * number of display refreshes, starting at the top of the screen, without
+   * tearing.
+   *
+   * \see nextFrame() setFrameDuration() Arduboy2Core::setDisplayRefresh()
    */
   void setFrameRate(uint8_t rate);
 
@@ -795,7 +1236,10 @@ class Arduboy2Base : public Arduboy2Core
    * start of the game, but it can be changed at any time to alter the frame
    * update rate.
    *
-   * \see nextFrame() setFrameRate()
+   * If `ARDUBOY_DISPLAY_SYNC` is defined, the display clock is also set, as
+   * for `setFrameRate()`.
+   *
+   * \see nextFrame() setFrameRate() Arduboy2Core::setDisplayRefresh()
    */
   void setFrameDuration(uint8_t duration);
 
@@ -1086,6 +1530,44 @@ class Arduboy2Base : public Arduboy2Core
    */
   static bool collide(Rect rect1, Rect rect2);
 
+  /** \brief
+   * Test if the masks of two sprites overlap.
+   *
+   * \param x1,y1 The location of the top left pixel of the first sprite.
+   * \param bitmap1 A pointer to the first sprite's image array.
+   * \param mask1 A pointer to the first sprite's mask array, or `NULL` if
+   * `bitmap1` contains both image and mask data.
+   * \param frame1 The frame number of the first sprite.
+   * \param x2,y2 The location of the top left pixel of the second sprite.
+   * \param bitmap2 A pointer to the second sprite's image array.
+   * \param mask2 A pointer to the second sprite's mask array, or `NULL` if
+   * `bitmap2` contains both image and mask data.
+   * \param frame2 The frame number of the second sprite.
+   *
+   * \return `true` if a pixel set in one mask is at the same location as a
+   * pixel set in the other.
+   *
+   * \details
+   * The arrays are in the same format as for the `Sprites` functions and
+   * are located in program memory. A sprite drawn with
+   * `Sprites::drawPlusMask()` is given with its array as the bitmap and
+   * `NULL` as the mask. For a sprite drawn with
+   * `Sprites::drawExternalMask()`, give both arrays. To use the image itself
+   * as the mask, for example for a sprite drawn with
+   * `Sprites::drawSelfMasked()`, give `bitmap + 2` as the mask.
+   *
+   * Only the area where the sprites' rectangles intersect is tested. The
+   * mask bytes of one sprite are shifted into line with the bytes of the
+   * other and tested 8 pixels at a time, returning as soon as an overlap
+   * is found.
+   *
+   * \see collide(Rect, Rect) Sprites
+   */
+  static bool collideMasks(int16_t x1, int16_t y1, const uint8_t *bitmap1,
+                           const uint8_t *mask1, uint8_t frame1,
+                           int16_t x2, int16_t y2, const uint8_t *bitmap2,
+                           const uint8_t *mask2, uint8_t frame2);
+
   /** \brief
    * Read the unit ID from system EEPROM.
    *
@@ -1379,12 +1861,69 @@ class Arduboy2Base : public Arduboy2Core
   void fillCircleHelper(int16_t x0, int16_t y0, uint8_t r,
                         uint8_t sides, int16_t delta, uint8_t color = WHITE);
 
+  // fill columns x to x + w - 1 from row top to row bottom, already clipped
+  // to the screen, a page at a time using masks for the top and bottom bytes
+  static void fillSpans(uint8_t x, uint8_t w, uint8_t top, uint8_t bottom,
+                        uint8_t color);
+
+  // fill rows top to bottom of a single page, with columns left[i] to
+  // right[i] of row top + i, for fillTriangle(). The columns covered by all
+  // the rows are filled a whole byte at a time.
+  static void fillTriangleRows(const int16_t* left, const int16_t* right,
+                               uint8_t top, uint8_t bottom, uint8_t color);
+
   // helper for drawCompressed()
   struct BitStreamReader;
 
+  // display refresh within a grayscale image, for displayGray()
+  // 0, 1: high bit plane, 2: low bit plane
+  static uint8_t grayPhase;
+
+#if !(defined(GU12864_800B) || defined(OLED_96X96) || defined(OLED_128X96) || defined(OLED_128X128) || defined(OLED_128X64_ON_96X96) || defined(OLED_128X64_ON_128X96) || defined(OLED_128X64_ON_128X128) || defined(OLED_128X96_ON_128X128) || defined(OLED_96X96_ON_128X128) || defined(OLED_64X128_ON_128X128))
+  // screen buffer column and row shown at the top left of the screen
+  static uint8_t scrollX;
+  static uint8_t scrollY;
+#endif
+
+#ifdef ARDUBOY_GRAY4
+  // left edge of the strip being rendered by displayGray4()
+  static int16_t gray4Left;
+
+  // buffer location of the top of a column in the current strip
+  static inline uint8_t* gray4Column(int16_t x) __attribute__((always_inline))
+  {
+    return sBuffer + ((x - gray4Left) >> 1) * HEIGHT;
+  }
+#endif
+
   // swap the values of two int16_t variables passed by reference
   void swapInt16(int16_t& a, int16_t& b);
 
+ #ifdef ARDUBOY_DIRTY_RECT
+  // first and last column of a page, empty when start > end
+  struct DirtySpan
+  {
+    uint8_t start;
+    uint8_t end;
+  };
+
+  // columns changed since the last display update, and columns drawn to
+  // since the last clear, for each page of the display buffer
+  static DirtySpan dirtySpans[HEIGHT / 8];
+  static DirtySpan drawnSpans[HEIGHT / 8];
+
+  static inline void markDirtySpan(uint8_t page, uint8_t start, uint8_t end) __attribute__((always_inline))
+  {
+    if (start < dirtySpans[page].start) dirtySpans[page].start = start;
+    if (end > dirtySpans[page].end) dirtySpans[page].end = end;
+    if (start < drawnSpans[page].start) drawnSpans[page].start = start;
+    if (end > drawnSpans[page].end) drawnSpans[page].end = end;
+  }
+
+  // called after the display has been updated
+  static void resetDirtySpans(bool clear);
+ #endif
+
   // For button handling
   uint8_t currentButtonState;
   uint8_t previousButtonState;
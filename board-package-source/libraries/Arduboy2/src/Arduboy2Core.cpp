@@ -165,6 +165,9 @@ void Arduboy2Core::boot()
 
   bootPins();
   bootSPI();
+ #ifdef ARDUBOY_I2C_TWI
+  bootTWI();
+ #endif
   bootOLED();
   bootPowerSaving();
 }
@@ -404,6 +407,16 @@ void Arduboy2Core::bootSPI()
   SPSR = _BV(SPI2X);
 }
 
+#ifdef ARDUBOY_I2C_TWI
+void Arduboy2Core::bootTWI()
+{
+  // no prescaler, maximum bit rate: CPU clock / 16 (1MHz)
+  TWSR = 0;
+  TWBR = 0;
+  TWCR = _BV(TWEN);
+}
+#endif
+
 // Write to the SPI bus (MOSI pin)
 void Arduboy2Core::SPItransfer(uint8_t data)
 {
@@ -418,7 +431,27 @@ void Arduboy2Core::SPItransfer(uint8_t data)
   while (!(SPSR & _BV(SPIF))) { } // wait
 }
 
-#if defined(OLED_SSD1306_I2C) || (OLED_SSD1306_I2CX)
+#if defined(ARDUBOY_I2C_TWI)
+// The display doesn't have to be checked for an ACK, the same as with the
+// bit banged version below, so the TWI status codes are ignored.
+void Arduboy2Core::i2c_start(uint8_t mode)
+{
+ #ifdef ARDUBOY_BACKGROUND_DISPLAY
+  while (displayBusy()) { }
+ #endif
+  while (TWCR & _BV(TWSTO)) { } // wait for the previous stop condition
+  TWCR = _BV(TWINT) | _BV(TWSTA) | _BV(TWEN);
+  i2c_sendByte(SSD1306_I2C_ADDR << 1);
+  i2c_sendByte(mode);
+}
+
+void Arduboy2Core::i2c_sendByte(uint8_t byte)
+{
+  while (!(TWCR & _BV(TWINT))) { } // wait for the previous byte or start
+  TWDR = byte;
+  TWCR = _BV(TWINT) | _BV(TWEN);
+}
+#elif defined(OLED_SSD1306_I2C) || (OLED_SSD1306_I2CX)
 void Arduboy2Core::i2c_start(uint8_t mode)
 {
   I2C_SDA_LOW();       // disable posible internal pullup, ensure SDA low on enabling output
@@ -493,7 +526,11 @@ void Arduboy2Core::bootPowerSaving()
 {
   // disable Two Wire Interface (I2C) and the ADC
   // All other bits will be written with 0 so will be enabled
+ #ifdef ARDUBOY_I2C_TWI
+  PRR0 = _BV(PRADC); // the TWI drives the display
+ #else
   PRR0 = _BV(PRTWI) | _BV(PRADC);
+ #endif
   // disable USART1
   PRR1 = _BV(PRUSART1);
 }
@@ -563,8 +600,86 @@ void Arduboy2Core::paint8Pixels(uint8_t pixels)
 #endif
 }
 
+#ifdef ARDUBOY_DISPLAY_SYNC
+// commands sent by unparkDisplay(), the display clock and contrast are set
+// at run time
+static uint8_t unparkProgram[] = {
+  0xD5, 0xF0,       // Set Display Clock Divisor
+  0xA8, HEIGHT - 1, // Set Multiplex Ratio to all rows
+  0x81, 0xCF        // Set Contrast v = 0xCF
+};
+
+void Arduboy2Core::parkDisplay()
+{
+  LCDCommandMode();
+  SPItransfer(0x81); // Set Contrast v = 0
+  SPItransfer(0x00);
+  SPItransfer(0xA8); // Set Multiplex Ratio to a single row
+  SPItransfer(0x00);
+  LCDDataMode();
+}
+
+void Arduboy2Core::unparkDisplay()
+{
+  LCDCommandMode();
+  for (uint8_t i = 0; i < sizeof(unparkProgram); i++)
+  {
+    SPItransfer(unparkProgram[i]);
+  }
+  LCDDataMode();
+}
+
+void Arduboy2Core::setDisplayClock(uint8_t clock)
+{
+  unparkProgram[1] = clock;
+}
+
+void Arduboy2Core::setDisplayContrast(uint8_t contrast)
+{
+  unparkProgram[5] = contrast;
+}
+
+void Arduboy2Core::setDisplayRefresh(uint8_t duration)
+{
+  // Time between two images that the display is scanning. About 1.2ms of
+  // the frame is spent parked while the image is sent.
+  int32_t frameUs = duration * 1000L - 1200;
+  uint32_t bestWaste = 0xFFFFFFFF;
+  uint8_t best = 0xF0;
+
+  for (uint8_t osc = 0; osc < 16; osc++)
+  {
+    // typical oscillator frequency is about 250kHz + 15kHz per step. Each
+    // row takes 66 clocks with the precharge set by the boot program.
+    uint16_t rowsUs = (HEIGHT * 66 * 1000L) / (250 + 15 * osc);
+    for (uint8_t divide = 1; divide <= 16; divide++)
+    {
+      int32_t scanUs = (int32_t)rowsUs * divide;
+      if (scanUs > frameUs)
+      {
+        break;
+      }
+      uint32_t waste = frameUs % scanUs;
+      if (waste < bestWaste)
+      {
+        bestWaste = waste;
+        best = (osc << 4) | (divide - 1);
+      }
+    }
+  }
+  setDisplayClock(best);
+}
+#endif
+
 void Arduboy2Core::paintScreen(const uint8_t *image)
 {
+ #ifdef ARDUBOY_BACKGROUND_DISPLAY
+  while (displayBusy()) { }
+ #endif
+  resetStartLine();
+ #ifdef ARDUBOY_DISPLAY_SYNC
+  parkDisplay();
+ #endif
 #if defined(GU12864_800B) 
   displayEnable();
   for (uint8_t r = 0; r < (HEIGHT/8); r++)
@@ -656,12 +771,21 @@ void Arduboy2Core::paintScreen(const uint8_t *image)
     SPItransfer(pgm_read_byte(image + i));
   }
 #endif
+ #ifdef ARDUBOY_DISPLAY_SYNC
+  unparkDisplay();
+ #endif
 }
 
 // paint from a memory buffer, this should be FAST as it's likely what
 // will be used by any buffer based subclass
 void Arduboy2Core::paintScreen(uint8_t image[], bool clear)
 {
+ #ifdef ARDUBOY_BACKGROUND_DISPLAY
+  while (displayBusy()) { }
+ #endif
+ #ifdef ARDUBOY_DISPLAY_SYNC
+  parkDisplay();
+ #endif
 #if defined(GU12864_800B) 
   displayEnable();
   for (uint8_t r = 0; r < (HEIGHT/8); r++)
@@ -685,6 +809,20 @@ void Arduboy2Core::paintScreen(uint8_t image[], bool clear)
     }
   }
   displayDisable();
+#elif defined(ARDUBOY_I2C_TWI)
+  // each byte is fetched while the previous one is being sent
+  i2c_start(SSD1306_I2C_DATA);
+  for (uint16_t i = 0; i < WIDTH * HEIGHT / 8; i++)
+  {
+    uint8_t b = *image;
+    if (clear)
+    {
+      *image = 0;
+    }
+    image++;
+    i2c_sendByte(b);
+  }
+  i2c_stop();
 #elif defined(OLED_SSD1306_I2C) || (OLED_SSD1306_I2CX)
   uint16_t length = WIDTH * HEIGHT / 8;
   uint8_t sda_clr = I2C_PORT & ~((1 << I2C_SDA) | (1 << I2C_SCL));
@@ -976,7 +1114,269 @@ void Arduboy2Core::paintScreen(uint8_t image[], bool clear)
       [clear]   "r"   (clear)
   );
   #endif  
+ #ifdef ARDUBOY_DISPLAY_SYNC
+  unparkDisplay();
+ #endif
 }
+
+#ifdef ARDUBOY_GRAY4
+// paint a strip of packed 4 bit pixels. Same data only transfer as the
+// SSD1306 paintScreen(), as the pixels need no expanding
+void Arduboy2Core::paintScreenGray4(uint8_t image[], bool clear)
+{
+  uint16_t count;
+
+  asm volatile (
+    "   ldi   %A[count], %[len_lsb]               \n\t" //for (len = WIDTH * HEIGHT / 8)
+    "   ldi   %B[count], %[len_msb]               \n\t"
+    "1: ld    __tmp_reg__, %a[ptr]      ;2        \n\t" //tmp = *(image)
+    "   out   %[spdr], __tmp_reg__      ;1        \n\t" //SPDR = tmp
+    "   cpse  %[clear], __zero_reg__    ;1/2      \n\t" //if (clear) tmp = 0;
+    "   mov   __tmp_reg__, __zero_reg__ ;1        \n\t"
+    "2: sbiw  %A[count], 1              ;2        \n\t" //len --
+    "   sbrc  %A[count], 0              ;1/2      \n\t" //loop twice for cheap delay
+    "   rjmp  2b                        ;2        \n\t"
+    "   st    %a[ptr]+, __tmp_reg__     ;2        \n\t" //*(image++) = tmp
+    "   brne  1b                        ;1/2 :18  \n\t" //len > 0
+    "   in    __tmp_reg__, %[spsr]                \n\t" //read SPSR to clear SPIF
+    : [ptr]     "+&e" (image),
+      [count]   "=&w" (count)
+    : [spdr]    "I"   (_SFR_IO_ADDR(SPDR)),
+      [spsr]    "I"   (_SFR_IO_ADDR(SPSR)),
+      [len_msb] "M"   (WIDTH * (HEIGHT / 8 * 2) >> 8),   // 8: same size as a 1 bit screen
+      [len_lsb] "M"   (WIDTH * (HEIGHT / 8 * 2) & 0xFF), // 2: for delay loop multiplier
+      [clear]   "r"   (clear)
+  );
+}
+#endif
+
+// paint a part of a single page from a memory buffer. The display's address
+// pointer is restored afterwards so paintScreen() can still be used.
+void Arduboy2Core::paintScreenSpan(uint8_t image[], uint8_t page, uint8_t start, uint8_t end)
+{
+  uint8_t* ptr = image + page * WIDTH + start;
+  uint8_t count = end - start + 1;
+#if defined(GU12864_800B)
+  displayEnable();
+  displayWrite(0x64);  // set x position
+  displayWrite(start);
+  displayWrite(0x60);  // set y position
+  displayWrite(page);
+  LCDDataMode();
+  do
+  {
+    displayWrite(*(ptr++));
+  }
+  while (--count);
+  LCDCommandMode();
+  displayWrite(0x64);  // restore x position 0
+  displayWrite(0x00);
+  displayDisable();
+#elif defined(OLED_SSD1306_I2C) || (OLED_SSD1306_I2CX)
+  i2c_start(SSD1306_I2C_CMD);
+  i2c_sendByte(OLED_SET_COLUMN_RANGE);
+  i2c_sendByte(start);
+  i2c_sendByte(end);
+  i2c_sendByte(OLED_SET_PAGE_RANGE);
+  i2c_sendByte(page);
+  i2c_sendByte(page);
+  i2c_stop();
+  i2c_start(SSD1306_I2C_DATA);
+  do
+  {
+    i2c_sendByte(*(ptr++));
+  }
+  while (--count);
+  i2c_stop();
+  i2c_start(SSD1306_I2C_CMD);
+  i2c_sendByte(OLED_SET_COLUMN_RANGE);
+  i2c_sendByte(0);
+  i2c_sendByte(COLUMN_ADDRESS_END);
+  i2c_sendByte(OLED_SET_PAGE_RANGE);
+  i2c_sendByte(0);
+  i2c_sendByte(PAGE_ADDRESS_END);
+  i2c_stop();
+#elif defined(OLED_SH1106) || defined(LCD_ST7565)
+  uint8_t column = start + OLED_SET_COLUMN_ADDRESS_LO; // SH1106 column offset
+  LCDCommandMode();
+  SPItransfer(OLED_SET_PAGE_ADDRESS + page);
+  SPItransfer(OLED_SET_COLUMN_ADDRESS_HI | (column >> 4));
+  SPItransfer(column & 0x0F);
+  LCDDataMode();
+  do
+  {
+    SPItransfer(*(ptr++));
+  }
+  while (--count);
+  // paintScreen() only resets the hi nibble of the column address
+  sendLCDCommand(OLED_SET_COLUMN_ADDRESS_LO);
+#elif defined(OLED_96X96) || defined(OLED_128X96) || defined(OLED_128X128) || defined(OLED_128X64_ON_96X96) || defined(OLED_128X64_ON_128X96) || defined(OLED_128X64_ON_128X128) || defined(OLED_128X96_ON_128X128) || defined(OLED_96X96_ON_128X128) || defined(OLED_64X128_ON_128X128)
+  // 4-bit displays: no page addressing, paint the whole image
+  paintScreen(image, false);
+#else
+  //OLED SSD1306 and compatibles
+  LCDCommandMode();
+  SPItransfer(OLED_SET_COLUMN_RANGE);
+  SPItransfer(start);
+  SPItransfer(end);
+  SPItransfer(OLED_SET_PAGE_RANGE);
+  SPItransfer(page);
+  SPItransfer(page);
+  LCDDataMode();
+  do
+  {
+    SPItransfer(*(ptr++));
+  }
+  while (--count);
+  LCDCommandMode();
+  SPItransfer(OLED_SET_COLUMN_RANGE);
+  SPItransfer(0);
+  SPItransfer(COLUMN_ADDRESS_END);
+  SPItransfer(OLED_SET_PAGE_RANGE);
+  SPItransfer(0);
+  SPItransfer(PAGE_ADDRESS_END);
+  LCDDataMode();
+#endif
+}
+
+#if !(defined(GU12864_800B) || defined(OLED_96X96) || defined(OLED_128X96) || defined(OLED_128X128) || defined(OLED_128X64_ON_96X96) || defined(OLED_128X64_ON_128X96) || defined(OLED_128X64_ON_128X128) || defined(OLED_128X96_ON_128X128) || defined(OLED_96X96_ON_128X128) || defined(OLED_64X128_ON_128X128))
+// paint whole pages with the columns sent in rotated order. The column
+// range is left at the full width, so only the page range has to be set.
+void Arduboy2Core::paintScreenPages(uint8_t image[], uint8_t page, uint8_t count, uint8_t offset)
+{
+  uint8_t* row = image + page * WIDTH;
+#if defined(OLED_SSD1306_I2C) || (OLED_SSD1306_I2CX)
+  i2c_start(SSD1306_I2C_CMD);
+  i2c_sendByte(OLED_SET_COLUMN_RANGE);
+  i2c_sendByte(0);
+  i2c_sendByte(COLUMN_ADDRESS_END);
+  i2c_sendByte(OLED_SET_PAGE_RANGE);
+  i2c_sendByte(page);
+  i2c_sendByte(page + count - 1);
+  i2c_stop();
+  i2c_start(SSD1306_I2C_DATA);
+  do
+  {
+    uint8_t* ptr = row + offset;
+    for (uint8_t i = WIDTH; i > 0; i--)
+    {
+      i2c_sendByte(*(ptr++));
+      if (ptr == row + WIDTH) ptr = row;
+    }
+    row += WIDTH;
+  }
+  while (--count);
+  i2c_stop();
+  i2c_start(SSD1306_I2C_CMD);
+  i2c_sendByte(OLED_SET_PAGE_RANGE);
+  i2c_sendByte(0);
+  i2c_sendByte(PAGE_ADDRESS_END);
+  i2c_stop();
+#elif defined(OLED_SH1106) || defined(LCD_ST7565)
+  do
+  {
+    LCDCommandMode();
+    SPItransfer(OLED_SET_PAGE_ADDRESS + page++);
+    SPItransfer(OLED_SET_COLUMN_ADDRESS_HI);
+    SPItransfer(OLED_SET_COLUMN_ADDRESS_LO);
+    LCDDataMode();
+    uint8_t* ptr = row + offset;
+    for (uint8_t i = WIDTH; i > 0; i--)
+    {
+      SPItransfer(*(ptr++));
+      if (ptr == row + WIDTH) ptr = row;
+    }
+    row += WIDTH;
+  }
+  while (--count);
+#else
+  //OLED SSD1306 and compatibles
+  LCDCommandMode();
+  SPItransfer(OLED_SET_COLUMN_RANGE);
+  SPItransfer(0);
+  SPItransfer(COLUMN_ADDRESS_END);
+  SPItransfer(OLED_SET_PAGE_RANGE);
+  SPItransfer(page);
+  SPItransfer(page + count - 1);
+  LCDDataMode();
+  do
+  {
+    uint8_t* ptr = row + offset;
+    for (uint8_t i = WIDTH; i > 0; i--)
+    {
+      SPItransfer(*(ptr++));
+      if (ptr == row + WIDTH) ptr = row;
+    }
+    row += WIDTH;
+  }
+  while (--count);
+  LCDCommandMode();
+  SPItransfer(OLED_SET_PAGE_RANGE);
+  SPItransfer(0);
+  SPItransfer(PAGE_ADDRESS_END);
+  LCDDataMode();
+#endif
+}
+
+static uint8_t startLine; // display RAM line shown at the top
+
+void Arduboy2Core::setStartLine(uint8_t line)
+{
+  startLine = line;
+  sendLCDCommand(OLED_SET_START_LINE | line);
+}
+#endif
+
+void Arduboy2Core::resetStartLine()
+{
+#if !(defined(GU12864_800B) || defined(OLED_96X96) || defined(OLED_128X96) || defined(OLED_128X128) || defined(OLED_128X64_ON_96X96) || defined(OLED_128X64_ON_128X96) || defined(OLED_128X64_ON_128X128) || defined(OLED_128X96_ON_128X128) || defined(OLED_96X96_ON_128X128) || defined(OLED_64X128_ON_128X128))
+  if (startLine)
+  {
+    setStartLine(0);
+  }
+#endif
+}
+
+#ifdef ARDUBOY_BACKGROUND_DISPLAY
+// second buffer and transfer state for paintScreenBackground()
+static uint8_t paintBuffer[(HEIGHT * WIDTH) / 8];
+static uint8_t* paintPtr;
+
+// Send the next byte of a background transfer, or the stop condition after
+// the last one, which also disables the interrupt. Called from the TWI
+// interrupt after the previous byte has been sent.
+ISR(TWI_vect)
+{
+  if (paintPtr != paintBuffer + sizeof(paintBuffer))
+  {
+    TWDR = *(paintPtr++);
+    TWCR = _BV(TWINT) | _BV(TWEN) | _BV(TWIE);
+  }
+  else
+  {
+    TWCR = _BV(TWINT) | _BV(TWEN) | _BV(TWSTO);
+  }
+}
+
+void Arduboy2Core::paintScreenBackground(uint8_t image[], bool clear)
+{
+  while (displayBusy()) { }
+  resetStartLine();
+  memcpy(paintBuffer, image, sizeof(paintBuffer));
+  if (clear)
+  {
+    memset(image, 0, sizeof(paintBuffer));
+  }
+  paintPtr = paintBuffer;
+
+  // address the display polled, then the interrupt sends the data bytes
+  i2c_start(SSD1306_I2C_DATA);
+  while (!(TWCR & _BV(TWINT))) { }
+  TWDR = *(paintPtr++);
+  TWCR = _BV(TWINT) | _BV(TWEN) | _BV(TWIE);
+}
+#endif
+
 #if 0
 // For reference, this is the "closed loop" C++ version of paintScreen()
 // used prior to the above version.
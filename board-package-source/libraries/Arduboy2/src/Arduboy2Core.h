@@ -32,6 +32,71 @@ extern volatile unsigned char bootloader_timer;
 // #define AB_DEVKIT    //< compile for the official dev kit
 #endif
 
+/* Uncomment ARDUBOY_BACKGROUND_DISPLAY (or pass it as a -D compiler option)
+ * together with ARDUBOY_I2C_TWI to have display() copy the screen buffer to
+ * a second buffer and return immediately, while the TWI interrupt sends the
+ * copy to the display. This uses (WIDTH * HEIGHT) / 8 bytes of extra RAM.
+ * See displayBusy().
+ *
+ * It has no effect on the SPI displays. At 8MHz an SPI byte is sent in 16
+ * CPU cycles, less than it takes to enter and leave an interrupt, so an
+ * interrupt driven SPI transfer can't overlap with the sketch on the
+ * ATmega32U4 and would only be slower than paintScreen(). A TWI byte at 1MHz
+ * takes about 144 cycles.
+ */
+// #define ARDUBOY_BACKGROUND_DISPLAY
+
+/* Uncomment ARDUBOY_GRAY4 (or pass it as a -D compiler option) to add the
+ * 16 level grayscale functions for the 4 bit per pixel displays. The screen
+ * buffer is then also used as a packed 4 bit per pixel buffer for one
+ * vertical strip of the screen at a time. See Arduboy2Base::displayGray4().
+ */
+// #define ARDUBOY_GRAY4
+
+/* Uncomment ARDUBOY_DISPLAY_SYNC (or pass it as a -D compiler option) to
+ * stop the display's row scan while an image is sent to it and restart the
+ * scan from the top afterwards, so a refresh never shows parts of two
+ * frames. setFrameRate() also sets the display clock so the display
+ * refreshes a whole number of times per frame. See parkDisplay().
+ *
+ * The display is dark while the image is sent, which takes 1 to 2ms of each
+ * frame, so the image is somewhat dimmer (around a tenth at 60 frames per
+ * second). The contrast is set again after each image, so it must be changed
+ * with setDisplayContrast() instead of sending the Set Contrast command.
+ * It is needed for stable shades with Arduboy2Base::displayGray().
+ */
+// #define ARDUBOY_DISPLAY_SYNC
+
+/* Uncomment ARDUBOY_I2C_TWI (or pass it as a -D compiler option) to drive
+ * an SSD1306 I2C display with the hardware Two Wire Interface at 1MHz
+ * instead of bit banging the bus. The display must be connected to the
+ * TWI pins (SCL on pin 3, SDA on pin 2). Together with
+ * ARDUBOY_BACKGROUND_DISPLAY the screen is then sent by the TWI interrupt
+ * while the sketch continues.
+ */
+// #define ARDUBOY_I2C_TWI
+
+#if !(defined(OLED_SSD1306_I2C) || (OLED_SSD1306_I2CX))
+ // only used by the I2C displays
+ #undef ARDUBOY_I2C_TWI
+#endif
+
+#if defined(OLED_SSD1306_I2C) || (OLED_SSD1306_I2CX) || defined(GU12864_800B) || defined(OLED_SH1106) || defined(LCD_ST7565) || defined(OLED_96X96) || defined(OLED_128X96) || defined(OLED_128X128) || defined(OLED_128X64_ON_96X96) || defined(OLED_128X64_ON_128X96) || defined(OLED_128X64_ON_128X128) || defined(OLED_128X96_ON_128X128) || defined(OLED_96X96_ON_128X128) || defined(OLED_64X128_ON_128X128)
+ // only the SSD1306 and SSD1309 on SPI are supported
+ #undef ARDUBOY_DISPLAY_SYNC
+#endif
+
+#if !(defined(OLED_96X96) || defined(OLED_128X96) || defined(OLED_128X128) || defined(OLED_128X64_ON_128X96) || defined(OLED_128X64_ON_128X128) || defined(OLED_128X96_ON_128X128) || defined(OLED_96X96_ON_128X128))
+ // only displays that take the whole buffer as a plain stream of 4 bit
+ // pixels are supported
+ #undef ARDUBOY_GRAY4
+#endif
+
+#ifndef ARDUBOY_I2C_TWI
+ // only the TWI is slow enough for an interrupt per byte to pay off
+ #undef ARDUBOY_BACKGROUND_DISPLAY
+#endif
+
 #define RGB_ON LOW   /**< For digitially setting an RGB LED on using digitalWriteRGB() */
 #define RGB_OFF HIGH /**< For digitially setting an RGB LED off using digitalWriteRGB() */
 
@@ -82,12 +147,20 @@ extern volatile unsigned char bootloader_timer;
  #define I2C_PORT  PORTD
  #define I2C_DDR   DDRD
  #define I2C_PIN   PIND
+#ifdef ARDUBOY_I2C_TWI
+ #if defined(CART_CS_SDA) || defined(AB_ALTERNATE_WIRING)
+  #error The hardware TWI pins are used by the flash cart or Pro Micro alternate wiring. Undefine ARDUBOY_I2C_TWI.
+ #endif
+ #define I2C_SCL PORTD0  // hardware TWI SCL
+ #define I2C_SDA PORTD1  // hardware TWI SDA
+#else
  #ifdef AB_ALTERNATE_WIRING
   #define I2C_SCL PORTD3
  #else
   #define I2C_SCL PORTD7
  #endif    
  #define I2C_SDA PORTD4
+#endif
  //port states
  #define I2C_SDA_HIGH() I2C_PORT |=  (1 << I2C_SDA)
  #define I2C_SCL_HIGH() I2C_PORT |=  (1 << I2C_SCL)
@@ -336,6 +409,10 @@ extern volatile unsigned char bootloader_timer;
   #define OLED_SET_COLUMN_ADDRESS_LO 0x00 
 #endif
 #define OLED_SET_COLUMN_ADDRESS_HI 0x10
+
+#define OLED_SET_COLUMN_RANGE 0x21 // SSD1306 horizontal addressing mode only
+#define OLED_SET_PAGE_RANGE   0x22 // SSD1306 horizontal addressing mode only
+#define OLED_SET_START_LINE   0x40 // display RAM line shown at the top, 0x40 - 0x7F
 // -----
 #if defined (OLED_96X96) || (OLED_96X96_ON_128X128)
   #define WIDTH 96
@@ -353,6 +430,9 @@ extern volatile unsigned char bootloader_timer;
 #define COLUMN_ADDRESS_END (WIDTH - 1) & 127   // 128 pixels wide
 #define PAGE_ADDRESS_END ((HEIGHT/8)-1) & 7    // 8 pages high
 
+#define GRAY4_STRIPS 4                            // strips per screen for displayGray4()
+#define GRAY4_STRIP_WIDTH (WIDTH / GRAY4_STRIPS)  // width of each strip in pixels
+
 /** \brief
  * Eliminate the USB stack to free up code space.
  *
@@ -553,9 +633,14 @@ class Arduboy2Core : public Arduboy2NoUSB
     
     void static inline i2c_stop() __attribute__((always_inline))
     {
+     #ifdef ARDUBOY_I2C_TWI
+      while (!(TWCR & _BV(TWINT))) { } // wait for the last byte to be sent
+      TWCR = _BV(TWINT) | _BV(TWEN) | _BV(TWSTO);
+     #else
       // SDA and SCL both are already low, from writing ACK bit no need to change state
       I2C_SDA_AS_INPUT(); // switch to input so SDA is pulled up externally first for stop condition
       I2C_SCL_AS_INPUT(); // pull up SCL externally
+     #endif
     }
     
     void static i2c_sendByte(uint8_t byte);
@@ -671,6 +756,94 @@ class Arduboy2Core : public Arduboy2NoUSB
      */
     static void paintScreen(const uint8_t *image);
 
+#ifdef ARDUBOY_DISPLAY_SYNC
+    /** \brief
+     * Stop the display's row scan before sending an image to it.
+     *
+     * \details
+     * This function is only available if `ARDUBOY_DISPLAY_SYNC` is defined.
+     * The multiplex ratio is set to a single row and the contrast to 0. The
+     * display then only drives one row, at minimum brightness, so the
+     * display RAM can be changed without any of it being shown. The other
+     * rows stay dark until `unparkDisplay()` is called.
+     *
+     * Both forms of `paintScreen()` call this function and
+     * `unparkDisplay()` by themselves. Code that sends image data to the
+     * display some other way should do the same.
+     *
+     * \see unparkDisplay() setDisplayRefresh()
+     */
+    static void parkDisplay();
+
+    /** \brief
+     * Restart the display's row scan after sending an image to it.
+     *
+     * \details
+     * This function is only available if `ARDUBOY_DISPLAY_SYNC` is defined.
+     * The display clock, multiplex ratio and contrast are restored. The
+     * display continues scanning from the top row, so each refresh of the
+     * display starts at a fixed time after the image was sent.
+     *
+     * \see parkDisplay() setDisplayClock() setDisplayContrast()
+     */
+    static void unparkDisplay();
+
+    /** \brief
+     * Set the display contrast used by `unparkDisplay()`.
+     *
+     * \param contrast The value for the SSD1306 Set Contrast command (0x81),
+     * from 0 (dimmest) to 255 (brightest). The default is 0xCF.
+     *
+     * \details
+     * This function is only available if `ARDUBOY_DISPLAY_SYNC` is defined.
+     * The contrast is set to 0 by `parkDisplay()` and restored to this value
+     * by `unparkDisplay()` for each image, so a contrast set by sending the
+     * command directly would only last until the next image. The value is
+     * sent to the display with the next image.
+     *
+     * \see unparkDisplay() setDisplayClock()
+     */
+    static void setDisplayContrast(uint8_t contrast);
+
+    /** \brief
+     * Set the display clock used by `unparkDisplay()`.
+     *
+     * \param clock The value for the SSD1306 Set Display Clock command
+     * (0xD5): oscillator frequency in the high nibble and clock divide ratio
+     * minus 1 in the low nibble.
+     *
+     * \details
+     * This function is only available if `ARDUBOY_DISPLAY_SYNC` is defined.
+     * The oscillator frequency of a display can differ from the typical
+     * value used by `setDisplayRefresh()`. This function can be used to
+     * calibrate the refresh rate for a particular display. The value is
+     * sent to the display with the next image.
+     *
+     * \see setDisplayRefresh() unparkDisplay()
+     */
+    static void setDisplayClock(uint8_t clock);
+
+    /** \brief
+     * Set the display clock for a frame duration.
+     *
+     * \param duration The duration of each frame in milliseconds.
+     *
+     * \details
+     * This function is only available if `ARDUBOY_DISPLAY_SYNC` is defined.
+     * `Arduboy2Base::setFrameRate()` and `Arduboy2Base::setFrameDuration()`
+     * call it by themselves.
+     *
+     * The display clock is chosen so that a whole number of display
+     * refreshes fits into the time between two images as closely as
+     * possible, using the typical oscillator frequency from the SSD1306
+     * datasheet. Any time left is spent on a partial refresh of the top
+     * rows, which makes them slightly brighter.
+     *
+     * \see setDisplayClock()
+     */
+    static void setDisplayRefresh(uint8_t duration);
+#endif
+
     /** \brief
      * Paints an entire image directly to the display from an array in RAM.
      *
@@ -695,6 +868,169 @@ class Arduboy2Core : public Arduboy2NoUSB
      */
     static void paintScreen(uint8_t image[], bool clear = false);
 
+    /** \brief
+     * Paints part of one page of an image in RAM to the display.
+     *
+     * \param image A byte array in RAM representing the entire contents of
+     * the display.
+     * \param page The page (row of 8 pixels high) to paint.
+     * \param start The first column of the page to paint.
+     * \param end The last column of the page to paint.
+     *
+     * \details
+     * The bytes `image[page * WIDTH + start]` to `image[page * WIDTH + end]`
+     * are written to the same location on the display. The rest of the
+     * display is left unchanged. The display's address pointer is restored
+     * afterwards, so `paintScreen()` can still be used at any time.
+     *
+     * This is much faster than `paintScreen()` when only a small part of the
+     * display has to be updated, especially with the I2C displays.
+     *
+     * \note
+     * The 4 bit per pixel displays (96x96, 128x96, 128x128) aren't supported.
+     * On these displays the entire image is painted instead.
+     *
+     * \see paintScreen() Arduboy2Base::displayDirty()
+     */
+    static void paintScreenSpan(uint8_t image[], uint8_t page, uint8_t start, uint8_t end);
+
+#if !(defined(GU12864_800B) || defined(OLED_96X96) || defined(OLED_128X96) || defined(OLED_128X128) || defined(OLED_128X64_ON_96X96) || defined(OLED_128X64_ON_128X96) || defined(OLED_128X64_ON_128X128) || defined(OLED_128X96_ON_128X128) || defined(OLED_96X96_ON_128X128) || defined(OLED_64X128_ON_128X128))
+    /** \brief
+     * Paints whole pages of an image in RAM to the display, with the columns
+     * rotated.
+     *
+     * \param image A byte array in RAM representing the entire contents of
+     * the display.
+     * \param page The first page (row of 8 pixels high) to paint.
+     * \param count The number of pages to paint. `page + count` must not be
+     * more than `HEIGHT / 8`.
+     * \param offset The column of the image that is painted at the left edge
+     * of the display. The columns to the left of it are painted at the right
+     * edge, so each page is treated as a ring of `WIDTH` columns.
+     *
+     * \details
+     * The display's address pointer is restored afterwards, so
+     * `paintScreen()` can still be used at any time. The columns are simply
+     * sent in rotated order, so rotating doesn't need any extra transfers.
+     *
+     * \note
+     * This function isn't available for the 4 bit per pixel displays and the
+     * GU12864.
+     *
+     * \see setStartLine() Arduboy2Base::displayScroll()
+     */
+    static void paintScreenPages(uint8_t image[], uint8_t page, uint8_t count, uint8_t offset);
+
+    /** \brief
+     * Set the line of the display RAM that is shown at the top of the screen.
+     *
+     * \param line The display RAM line, from 0 to `HEIGHT - 1`.
+     *
+     * \details
+     * The display shows its RAM as a ring of `HEIGHT` lines, starting at the
+     * given line. Changing the start line scrolls the screen vertically
+     * without sending any image data.
+     *
+     * \note
+     * This function isn't available for the 4 bit per pixel displays and the
+     * GU12864.
+     *
+     * \see paintScreenPages() resetStartLine() Arduboy2Base::setScroll()
+     */
+    static void setStartLine(uint8_t line);
+#endif
+
+    /** \brief
+     * Show the display RAM from line 0 at the top of the screen again.
+     *
+     * \details
+     * If the start line was changed by `setStartLine()` it's set back to 0,
+     * otherwise nothing is sent. `paintScreen(const uint8_t*)`,
+     * `Arduboy2Base::display()`, `Arduboy2Base::displayDirty()` and
+     * `FX::displayFrame()` call this function by themselves, so an image
+     * they send isn't shown scrolled after `Arduboy2Base::displayScroll()`
+     * was used. Code that sends an image to the display some other way
+     * should do the same.
+     *
+     * \see setStartLine()
+     */
+    static void resetStartLine();
+
+#ifdef ARDUBOY_GRAY4
+    /** \brief
+     * Paint a vertical strip of packed 4 bit pixels from RAM to the display.
+     *
+     * \param image A byte array in RAM of `(WIDTH * HEIGHT) / 8` bytes
+     * holding `GRAY4_STRIP_WIDTH` columns of 4 bit pixels.
+     * \param clear If `true` the array in RAM will be cleared to zeros upon
+     * return from this function. (optional; defaults to `false`)
+     *
+     * \details
+     * This function is only available if `ARDUBOY_GRAY4` is defined. The
+     * bytes are sent to the display as they are, without being expanded from
+     * 1 bit pixels, so each byte takes 18 cycles. Each byte holds two
+     * horizontally adjacent pixels, the left one in the high nibble. The
+     * bytes for each pair of columns follow each other from top to bottom.
+     *
+     * The display continues where the previous strip ended, so calling this
+     * function `GRAY4_STRIPS` times paints the whole screen.
+     *
+     * \see Arduboy2Base::displayGray4()
+     */
+    static void paintScreenGray4(uint8_t image[], bool clear = false);
+#endif
+
+#ifdef ARDUBOY_BACKGROUND_DISPLAY
+    /** \brief
+     * Start painting an image from RAM to the display in the background.
+     *
+     * \param image A byte array in RAM representing the entire contents of
+     * the display.
+     * \param clear If `true` the array in RAM will be cleared to zeros upon
+     * return from this function. (optional; defaults to `false`)
+     *
+     * \details
+     * This function is only available if `ARDUBOY_BACKGROUND_DISPLAY` is
+     * defined. It waits for a previous background transfer to complete,
+     * copies the image to a second buffer and returns. The copy is then sent
+     * to the display by the TWI interrupt, one byte per interrupt, while the
+     * sketch continues. `displayBusy()` returns `true` until the transfer has
+     * completed.
+     *
+     * `ARDUBOY_BACKGROUND_DISPLAY` only has an effect together with
+     * `ARDUBOY_I2C_TWI`. An SPI byte is sent in 16 CPU cycles, less than an
+     * interrupt takes, so an interrupt driven SPI transfer can't overlap with
+     * the sketch on the ATmega32U4.
+     *
+     * \see displayBusy() paintScreen()
+     */
+    static void paintScreenBackground(uint8_t image[], bool clear = false);
+#endif
+
+    /** \brief
+     * Test if a background display transfer is in progress.
+     *
+     * \return `true` if a transfer started by `paintScreenBackground()` is
+     * still in progress. Always `false` if `ARDUBOY_BACKGROUND_DISPLAY`
+     * isn't defined.
+     *
+     * \details
+     * The functions of this library that use the display wait for the
+     * transfer to complete by themselves. The transfer uses the TWI, so the
+     * SPI bus remains free for other devices, such as a flash chip.
+     *
+     * \see paintScreenBackground()
+     */
+    static inline bool displayBusy() __attribute__((always_inline))
+    {
+     #ifdef ARDUBOY_BACKGROUND_DISPLAY
+      // the interrupt is disabled when the stop condition is sent
+      return TWCR & _BV(TWIE);
+     #else
+      return false;
+     #endif
+    }
+
     /** \brief
      * Blank the display screen by setting all pixels off.
      *
@@ -1023,6 +1359,9 @@ class Arduboy2Core : public Arduboy2NoUSB
     // internals
     static void setCPUSpeed8MHz();
     static void bootSPI();
+#ifdef ARDUBOY_I2C_TWI
+    static void bootTWI();
+#endif
     static void bootOLED();
     static void bootPins();
     static void bootPowerSaving();
@@ -0,0 +1,279 @@
+/**
+ * @file CollisionGrid.h
+ * \brief
+ * A class template for finding the objects that may collide with each other.
+ */
+
+#ifndef CollisionGrid_h
+#define CollisionGrid_h
+
+#include "Arduboy2.h"
+
+/** \brief
+ * A class template for finding the objects that may collide with each other.
+ *
+ * \tparam objects The largest number of objects, from 1 to 255. Objects are
+ * identified by a number from 0 to `objects - 1`.
+ *
+ * \details
+ * Testing every object against every other object with
+ * `Arduboy2Base::collide()` takes a number of tests that grows with the
+ * square of the number of objects. A collision grid first finds the pairs of
+ * objects that are close to each other, so only those have to be tested.
+ *
+ * The screen is divided into cells of 8x8 pixels (16 columns and 8 rows on
+ * a 128x64 display). For each column and each row of cells the grid keeps one
+ * bit per object, telling if the object covers that column or row. Two
+ * objects can only collide if they share both a column and a row. The grid
+ * uses `(WIDTH / 8 + HEIGHT / 8) * ((objects + 7) / 8)` bytes of RAM, which is
+ * 96 bytes for 32 objects on a 128x64 display.
+ *
+ * The grid is usually filled each frame after moving the objects:
+ *
+ * \code{.cpp}
+ * CollisionGrid<32> grid;
+ *
+ * grid.clear();
+ * for (uint8_t i = 0; i < count; i++) {
+ *   grid.insert(i, Rect(object[i].x, object[i].y, 8, 8));
+ * }
+ * grid.forEachPair([](uint8_t a, uint8_t b) {
+ *   if (Arduboy2Base::collide(rect(a), rect(b))) {
+ *     hit(a, b);
+ *   }
+ * });
+ * \endcode
+ *
+ * The grid only finds candidates. Objects in the same cells don't
+ * necessarily overlap, so the pairs found still have to be tested with
+ * `Arduboy2Base::collide()` or `Arduboy2Base::collideMasks()`. Objects
+ * that are completely off the screen are not added to the grid.
+ *
+ * \note
+ * This class isn't included by `Arduboy2.h`. A sketch using it must add
+ * `#include <CollisionGrid.h>` after `#include <Arduboy2.h>`.
+ *
+ * \see Arduboy2Base::collide(Rect, Rect) Arduboy2Base::collideMasks()
+ */
+template<uint8_t objects>
+class CollisionGrid
+{
+  public:
+    /** \brief
+     * The number of bytes in a set of objects.
+     */
+    static constexpr uint8_t setSize = (objects + 7) / 8;
+
+    /** \brief
+     * A set of objects, one bit per object.
+     */
+    struct Set
+    {
+      uint8_t bits[setSize]; /**< Object `id` is bit `id % 8` of byte `id / 8` */
+
+      /** \brief
+       * Test if an object is in the set.
+       *
+       * \param id The number of the object.
+       *
+       * \return `true` if the object is in the set.
+       */
+      bool contains(uint8_t id) const
+      {
+        return bits[id / 8] & (1 << (id % 8));
+      }
+    };
+
+    /** \brief
+     * Remove all objects from the grid.
+     */
+    void clear()
+    {
+      memset(columnSets, 0, sizeof(columnSets));
+      memset(rowSets, 0, sizeof(rowSets));
+    }
+
+    /** \brief
+     * Add an object to the grid.
+     *
+     * \param id The number of the object, from 0 to `objects - 1`.
+     * \param rect The area covered by the object.
+     *
+     * \details
+     * Each object should only be added once after calling `clear()`.
+     */
+    void insert(uint8_t id, Rect rect)
+    {
+      uint8_t left, right, top, bottom;
+
+      if (id >= objects || !cells(rect, left, right, top, bottom)) {
+        return;
+      }
+
+      uint8_t index = id / 8;
+      uint8_t bit = 1 << (id % 8);
+
+      for (uint8_t column = left; column <= right; column++) {
+        columnSets[column].bits[index] |= bit;
+      }
+      for (uint8_t row = top; row <= bottom; row++) {
+        rowSets[row].bits[index] |= bit;
+      }
+    }
+
+    /** \brief
+     * Find the objects that may overlap an area.
+     *
+     * \param rect The area to test.
+     * \param result The set of objects that cover a cell the area covers.
+     *
+     * \return `true` if any objects were found.
+     */
+    bool query(Rect rect, Set& result) const
+    {
+      uint8_t left, right, top, bottom;
+
+      memset(result.bits, 0, setSize);
+      if (!cells(rect, left, right, top, bottom)) {
+        return false;
+      }
+      return candidates(left, right, top, bottom, result);
+    }
+
+    /** \brief
+     * Call a function for each object that may overlap an area.
+     *
+     * \param rect The area to test.
+     * \param callback A function or lambda called as `callback(id)`.
+     */
+    template<typename Callback>
+    void forEachCandidate(Rect rect, Callback callback) const
+    {
+      Set found;
+
+      if (query(rect, found)) {
+        forEach(found, 0, callback);
+      }
+    }
+
+    /** \brief
+     * Call a function for each pair of objects that may overlap.
+     *
+     * \param callback A function or lambda called as `callback(a, b)`, with
+     * `a` less than `b`.
+     *
+     * \details
+     * Each pair is found once. Two objects form a pair if they share a
+     * column and a row of cells.
+     */
+    template<typename Callback>
+    void forEachPair(Callback callback) const
+    {
+      for (uint8_t a = 0; a < objects; a++) {
+        Set found;
+        uint8_t index = a / 8;
+        uint8_t bit = 1 << (a % 8);
+        bool inserted = false;
+
+        // the objects sharing a column and a row with object a
+        memset(found.bits, 0, setSize);
+        for (uint8_t column = 0; column < columns; column++) {
+          if (columnSets[column].bits[index] & bit) {
+            orSet(found, columnSets[column]);
+            inserted = true;
+          }
+        }
+        if (!inserted) {
+          continue;
+        }
+
+        Set rowFound;
+        memset(rowFound.bits, 0, setSize);
+        for (uint8_t row = 0; row < rows; row++) {
+          if (rowSets[row].bits[index] & bit) {
+            orSet(rowFound, rowSets[row]);
+          }
+        }
+        for (uint8_t i = 0; i < setSize; i++) {
+          found.bits[i] &= rowFound.bits[i];
+        }
+
+        // report each pair once, from its lower numbered object
+        forEach(found, a + 1, [&](uint8_t b) { callback(a, b); });
+      }
+    }
+
+  private:
+    static constexpr uint8_t columns = WIDTH / 8;
+    static constexpr uint8_t rows = HEIGHT / 8;
+
+    Set columnSets[columns];
+    Set rowSets[rows];
+
+    // The range of cells covered by a rectangle, clipped to the screen.
+    // Returns false if it's completely off the screen.
+    static bool cells(Rect rect, uint8_t& left, uint8_t& right,
+                      uint8_t& top, uint8_t& bottom)
+    {
+      int16_t x2 = rect.x + rect.width - 1;
+      int16_t y2 = rect.y + rect.height - 1;
+
+      if (rect.width == 0 || rect.height == 0 ||
+          x2 < 0 || rect.x >= WIDTH || y2 < 0 || rect.y >= HEIGHT) {
+        return false;
+      }
+      left = rect.x < 0 ? 0 : rect.x / 8;
+      right = x2 >= WIDTH ? columns - 1 : x2 / 8;
+      top = rect.y < 0 ? 0 : rect.y / 8;
+      bottom = y2 >= HEIGHT ? rows - 1 : y2 / 8;
+      return true;
+    }
+
+    bool candidates(uint8_t left, uint8_t right, uint8_t top, uint8_t bottom,
+                    Set& result) const
+    {
+      Set rowFound;
+
+      memset(rowFound.bits, 0, setSize);
+      for (uint8_t column = left; column <= right; column++) {
+        orSet(result, columnSets[column]);
+      }
+      for (uint8_t row = top; row <= bottom; row++) {
+        orSet(rowFound, rowSets[row]);
+      }
+
+      uint8_t any = 0;
+      for (uint8_t i = 0; i < setSize; i++) {
+        result.bits[i] &= rowFound.bits[i];
+        any |= result.bits[i];
+      }
+      return any != 0;
+    }
+
+    static void orSet(Set& to, const Set& from)
+    {
+      for (uint8_t i = 0; i < setSize; i++) {
+        to.bits[i] |= from.bits[i];
+      }
+    }
+
+    // Call callback(id) for the objects in a set, starting at object first.
+    // Empty bytes of the set are skipped.
+    template<typename Callback>
+    static void forEach(const Set& set, uint8_t first, Callback callback)
+    {
+      for (uint8_t i = first / 8; i < setSize; i++) {
+        uint8_t bits = set.bits[i];
+        if (i == first / 8) {
+          bits &= 0xFF << (first % 8);
+        }
+        for (uint8_t id = i * 8; bits != 0; id++, bits >>= 1) {
+          if (bits & 1) {
+            callback(id);
+          }
+        }
+      }
+    }
+};
+
+#endif
@@ -6,38 +6,402 @@
 
 #include "Sprites.h"
 
-void Sprites::drawExternalMask(int16_t x, int16_t y, const uint8_t *bitmap,
-                               const uint8_t *mask, uint8_t frame, uint8_t mask_frame)
+// Screen area covered by the visible part of a sprite, worked out by
+// clipSprite() for the blitters below
+struct SpriteClip
 {
-  draw(x, y, bitmap, frame, mask, mask_frame, SPRITE_MASKED);
+  int16_t ofs;             // screen buffer index of the first byte drawn
+  uint16_t sprite_ofs;     // index of the first byte drawn in the sprite
+  int8_t sRow;             // screen page of the first row drawn
+  uint8_t yOffset;         // pixels the sprite is moved down within a page
+  uint8_t loop_h;          // number of rows to draw
+  uint8_t rendered_width;  // number of columns to draw
+  uint8_t start_h;         // first sprite page drawn
+  uint8_t xOffset;         // first sprite column drawn
+};
+
+static bool clipSprite(int16_t x, int16_t y, uint8_t w, uint8_t h,
+                       SpriteClip& clip)
+{
+  // no need to draw at all if we're offscreen
+  if (x + w <= 0 || x > WIDTH - 1 || y + h <= 0 || y > HEIGHT - 1)
+    return false;
+
+ #ifdef ARDUBOY_DIRTY_RECT
+  Arduboy2Base::markDirty(x, y, w, h);
+ #endif
+
+  // xOffset technically doesn't need to be 16 bit but the math operations
+  // are measurably faster if it is
+  uint16_t xOffset;
+  int8_t yOffset = y & 7;
+  int8_t sRow = y / 8;
+  uint8_t loop_h, start_h, rendered_width;
+
+  if (y < 0 && yOffset > 0) {
+    sRow--;
+  }
+
+  // if the left side of the render is offscreen skip those loops
+  if (x < 0) {
+    xOffset = abs(x);
+  } else {
+    xOffset = 0;
+  }
+
+  // if the right side of the render is offscreen skip those loops
+  if (x + w > WIDTH - 1) {
+    rendered_width = ((WIDTH - x) - xOffset);
+  } else {
+    rendered_width = (w - xOffset);
+  }
+
+  // if the top side of the render is offscreen skip those loops
+  if (sRow < -1) {
+    start_h = abs(sRow) - 1;
+  } else {
+    start_h = 0;
+  }
+
+  loop_h = h / 8 + (h % 8 > 0 ? 1 : 0); // divide, then round up
+
+  // if (sRow + loop_h - 1 > (HEIGHT/8)-1)
+  if (sRow + loop_h > (HEIGHT / 8)) {
+    loop_h = (HEIGHT / 8) - sRow;
+  }
+
+  // prepare variables for loops later so we can compare with 0
+  // instead of comparing two variables
+  loop_h -= start_h;
+
+  sRow += start_h;
+  clip.ofs = (sRow * WIDTH) + x + xOffset;
+  clip.sprite_ofs = (start_h * w) + xOffset;
+  clip.sRow = sRow;
+  clip.yOffset = yOffset;
+  clip.loop_h = loop_h;
+  clip.rendered_width = rendered_width;
+  clip.start_h = start_h;
+  clip.xOffset = xOffset;
+  return true;
 }
 
-void Sprites::drawOverwrite(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame)
+// combine a byte of sprite data with a screen buffer byte
+template<uint8_t draw_mode>
+static inline uint8_t blendSprite(uint8_t data, uint8_t bitmap_data,
+                                  uint8_t mask_data) __attribute__((always_inline));
+template<uint8_t draw_mode>
+static inline uint8_t blendSprite(uint8_t data, uint8_t bitmap_data,
+                                  uint8_t mask_data)
 {
-  draw(x, y, bitmap, frame, NULL, 0, SPRITE_OVERWRITE);
+  if (draw_mode == SPRITE_IS_MASK)
+    return data | bitmap_data;
+  if (draw_mode == SPRITE_IS_MASK_ERASE)
+    return data & ~bitmap_data;
+  if (draw_mode == SPRITE_OVERWRITE)
+    return bitmap_data;
+  return (data & ~mask_data) | bitmap_data; // SPRITE_MASKED
 }
 
-void Sprites::drawErase(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame)
+// The blitter for a draw mode, with a version for sprites that start on a
+// page boundary. Those don't need shifting and only cover one page per row.
+// The mode and alignment are template parameters, so the compiler removes
+// the tests for them from the loops.
+//
+// The flipped version steps through the sprite by col_step bytes for each
+// column and row_jump bytes more for each row, and bit reverses the bytes
+// when flipping vertically. The version that isn't flipped ignores those
+// parameters and walks the sprite forward.
+template<uint8_t draw_mode, bool aligned, bool flipped>
+static void blitSprite(const SpriteClip& clip, const uint8_t *bofs,
+                       const uint8_t *mask_ofs, uint8_t w,
+                       int8_t col_step, int16_t row_jump, uint8_t flip)
 {
-  draw(x, y, bitmap, frame, NULL, 0, SPRITE_IS_MASK_ERASE);
+  if (!flipped) {
+    col_step = 1;
+    row_jump = w - clip.rendered_width;
+  }
+  bool flipV = flipped && (flip & SPRITE_FLIP_VERTICAL);
+
+  uint8_t *buffer = Arduboy2Base::sBuffer + clip.ofs;
+  int8_t sRow = clip.sRow;
+  uint8_t mul_amt = 1 << clip.yOffset;
+  uint8_t rendered_width = clip.rendered_width;
+
+  for (uint8_t a = clip.loop_h; a != 0; a--) {
+    bool firstPage = sRow >= 0;
+    bool secondPage = sRow < (HEIGHT / 8) - 1;
+
+    for (uint8_t iCol = rendered_width; iCol != 0; iCol--) {
+      uint8_t bitmap_data = pgm_read_byte(bofs);
+      bofs += col_step;
+      uint8_t mask_data = 0;
+      if (draw_mode == SPRITE_MASKED) {
+        mask_data = pgm_read_byte(mask_ofs);
+        mask_ofs += col_step;
+      }
+      if (flipV) {
+        bitmap_data = pgm_read_byte(&bitReverseTable[bitmap_data]);
+        if (draw_mode == SPRITE_MASKED) {
+          mask_data = pgm_read_byte(&bitReverseTable[mask_data]);
+        }
+      }
+
+      if (aligned) {
+        if (firstPage) {
+          *buffer = blendSprite<draw_mode>(*buffer, bitmap_data, mask_data);
+        }
+      } else {
+        // a shifted overwrite only replaces the 8 bits of our own sprite,
+        // the same as a mask of all ones
+        constexpr uint8_t shifted_mode =
+          (draw_mode == SPRITE_OVERWRITE) ? SPRITE_MASKED : draw_mode;
+        if (draw_mode == SPRITE_OVERWRITE) {
+          mask_data = 0xFF;
+        }
+        uint16_t bitmap_shifted = bitmap_data * mul_amt;
+        uint16_t mask_shifted = mask_data * mul_amt;
+
+        if (firstPage) {
+          *buffer = blendSprite<shifted_mode>(*buffer, bitmap_shifted,
+                                              mask_shifted);
+        }
+        if (secondPage) {
+          buffer[WIDTH] = blendSprite<shifted_mode>(buffer[WIDTH],
+                                                    bitmap_shifted >> 8,
+                                                    mask_shifted >> 8);
+        }
+      }
+      buffer++;
+    }
+    sRow++;
+    bofs += row_jump;
+    if (draw_mode == SPRITE_MASKED) {
+      mask_ofs += row_jump;
+    }
+    buffer += WIDTH - rendered_width;
+  }
 }
 
-void Sprites::drawSelfMasked(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame)
+// SPRITE_PLUS_MASK blitter. Not inlined because the assembly code labels
+// can only be used once.
+static void __attribute__((noinline))
+blitSpritePlusMask(const SpriteClip& clip, const uint8_t *bitmap, uint8_t w)
 {
-  draw(x, y, bitmap, frame, NULL, 0, SPRITE_IS_MASK);
+  uint8_t data;
+  uint16_t mask_data;
+  uint16_t bitmap_data;
+  int8_t sRow = clip.sRow;
+  uint8_t yOffset = clip.yOffset;
+  uint8_t loop_h = clip.loop_h;
+  uint8_t rendered_width = clip.rendered_width;
+  int16_t ofs = clip.ofs;
+  uint8_t mul_amt = 1 << yOffset;
+
+  // *2 because we use double the bits (mask + bitmap)
+  uint8_t *bofs = (uint8_t *)(bitmap + clip.sprite_ofs * 2);
+
+  uint8_t xi = rendered_width; // counter for x loop below
+
+  asm volatile(
+    "push r28\n" // save Y
+    "push r29\n"
+    "movw r28, %[buffer_ofs]\n" // Y = buffer_ofs_2
+    "adiw r28, 63\n" // buffer_ofs_2 = buffer_ofs + 128
+    "adiw r28, 63\n"
+    "adiw r28, 2\n"
+    "loop_y:\n"
+    "loop_x:\n"
+    // load bitmap and mask data
+    "lpm %A[bitmap_data], Z+\n"
+    "lpm %A[mask_data], Z+\n"
+
+    // shift mask and buffer data
+    "tst %[yOffset]\n"
+    "breq skip_shifting\n"
+    "mul %A[bitmap_data], %[mul_amt]\n"
+    "movw %[bitmap_data], r0\n"
+    "mul %A[mask_data], %[mul_amt]\n"
+    "movw %[mask_data], r0\n"
+
+    // SECOND PAGE
+    // if yOffset != 0 && sRow < 7
+    "cpi %[sRow], 7\n"
+    "brge end_second_page\n"
+    // then
+    "ld %[data], Y\n"
+    "com %B[mask_data]\n" // invert high byte of mask
+    "and %[data], %B[mask_data]\n"
+    "or %[data], %B[bitmap_data]\n"
+    // update buffer, increment
+    "st Y+, %[data]\n"
+
+    "end_second_page:\n"
+    "skip_shifting:\n"
+
+    // FIRST PAGE
+    // if sRow >= 0
+    "tst %[sRow]\n"
+    "brmi skip_first_page\n"
+    "ld %[data], %a[buffer_ofs]\n"
+    // then
+    "com %A[mask_data]\n"
+    "and %[data], %A[mask_data]\n"
+    "or %[data], %A[bitmap_data]\n"
+    // update buffer, increment
+    "st %a[buffer_ofs]+, %[data]\n"
+    "jmp end_first_page\n"
+
+    "skip_first_page:\n"
+    // since no ST Z+ when skipped we need to do this manually
+    "adiw %[buffer_ofs], 1\n"
+
+    "end_first_page:\n"
+
+    // "x_loop_next:\n"
+    "dec %[xi]\n"
+    "brne loop_x\n"
+
+    // increment y
+    "next_loop_y:\n"
+    "dec %[yi]\n"
+    "breq finished\n"
+    "mov %[xi], %[x_count]\n" // reset x counter
+    // sRow++;
+    "inc %[sRow]\n"
+    "clr __zero_reg__\n"
+    // sprite_ofs += (w - rendered_width) * 2;
+    "add %A[sprite_ofs], %A[sprite_ofs_jump]\n"
+    "adc %B[sprite_ofs], __zero_reg__\n"
+    // buffer_ofs += WIDTH - rendered_width;
+    "add %A[buffer_ofs], %A[buffer_ofs_jump]\n"
+    "adc %B[buffer_ofs], __zero_reg__\n"
+    // buffer_ofs_page_2 += WIDTH - rendered_width;
+    "add r28, %A[buffer_ofs_jump]\n"
+    "adc r29, __zero_reg__\n"
+
+    "rjmp loop_y\n"
+    "finished:\n"
+    // put the Y register back in place
+    "pop r29\n"
+    "pop r28\n"
+    "clr __zero_reg__\n" // just in case
+    : [xi] "+&a" (xi),
+    [yi] "+&a" (loop_h),
+    [sRow] "+&a" (sRow), // CPI requires an upper register (r16-r23)
+    [data] "=&l" (data),
+    [mask_data] "=&l" (mask_data),
+    [bitmap_data] "=&l" (bitmap_data)
+    :
+    [screen_width] "M" (WIDTH),
+    [x_count] "l" (rendered_width), // lower register
+    [sprite_ofs] "z" (bofs),
+    [buffer_ofs] "x" (Arduboy2Base::sBuffer+ofs),
+    [buffer_ofs_jump] "a" (WIDTH-rendered_width), // upper reg (r16-r23)
+    [sprite_ofs_jump] "a" ((w-rendered_width)*2), // upper reg (r16-r23)
+
+    // [sprite_ofs_jump] "r" (0),
+    [yOffset] "l" (yOffset), // lower register
+    [mul_amt] "l" (mul_amt) // lower register
+    // NOTE: We also clobber r28 and r29 (y) but sometimes the compiler
+    // won't allow us, so in order to make this work we don't tell it
+    // that we clobber them. Instead, we push/pop to preserve them.
+    // Then we need to guarantee that the the compiler doesn't put one of
+    // our own variables into r28/r29.
+    // We do that by specifying all the inputs and outputs use either
+    // lower registers (l) or simple (r16-r23) upper registers (a).
+    : // pushes/clobbers/pops r28 and r29 (y)
+  );
 }
 
-void Sprites::drawPlusMask(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame)
+template<uint8_t draw_mode>
+static void drawSpriteBitmap(int16_t x, int16_t y,
+                             const uint8_t *bitmap, const uint8_t *mask,
+                             uint8_t w, uint8_t h)
 {
-  draw(x, y, bitmap, frame, NULL, 0, SPRITE_PLUS_MASK);
+  SpriteClip clip;
+
+  if (bitmap == NULL || !clipSprite(x, y, w, h, clip))
+    return;
+
+  if (draw_mode == SPRITE_PLUS_MASK) {
+    blitSpritePlusMask(clip, bitmap, w);
+    return;
+  }
+
+  bitmap += clip.sprite_ofs;
+  if (draw_mode == SPRITE_MASKED) {
+    mask += clip.sprite_ofs;
+  }
+
+  if (clip.yOffset == 0) {
+    blitSprite<draw_mode, true, false>(clip, bitmap, mask, w, 1, 0, 0);
+  } else {
+    blitSprite<draw_mode, false, false>(clip, bitmap, mask, w, 1, 0, 0);
+  }
 }
 
+// Flipped version of drawSpriteBitmap()
+template<uint8_t draw_mode>
+static void drawSpriteBitmapFlipped(int16_t x, int16_t y,
+                                    const uint8_t *bitmap, const uint8_t *mask,
+                                    uint8_t w, uint8_t h, uint8_t flip)
+{
+  SpriteClip clip;
+
+  if (flip & SPRITE_FLIP_VERTICAL) {
+    // whole pages are flipped, so the unused rows at the bottom of the last
+    // page end up on top. Draw them above y.
+    uint8_t unused = -h & 7;
+    y -= unused;
+    h += unused;
+  }
 
-//common functions
-void Sprites::draw(int16_t x, int16_t y,
-                   const uint8_t *bitmap, uint8_t frame,
-                   const uint8_t *mask, uint8_t sprite_frame,
-                   uint8_t drawMode)
+  if (bitmap == NULL || !clipSprite(x, y, w, h, clip))
+    return;
+
+  // image and mask bytes alternate in a SPRITE_PLUS_MASK sprite, which is
+  // then drawn like a SPRITE_MASKED one
+  constexpr uint8_t blit_mode =
+    (draw_mode == SPRITE_PLUS_MASK) ? SPRITE_MASKED : draw_mode;
+  constexpr uint8_t step = (draw_mode == SPRITE_PLUS_MASK) ? 2 : 1;
+
+  uint8_t page = clip.start_h;
+  uint8_t column = clip.xOffset;
+  int8_t col_step = step;
+  int16_t page_step = w * step;
+
+  if (flip & SPRITE_FLIP_HORIZONTAL) {
+    column = w - 1 - column;
+    col_step = -col_step;
+  }
+  if (flip & SPRITE_FLIP_VERTICAL) {
+    page = (h + 7) / 8 - 1 - page;
+    page_step = -page_step;
+  }
+
+  uint16_t start = (page * w + column) * step;
+  int16_t row_jump = page_step - clip.rendered_width * col_step;
+
+  bitmap += start;
+  if (draw_mode == SPRITE_PLUS_MASK) {
+    mask = bitmap + 1;
+  } else if (draw_mode == SPRITE_MASKED) {
+    mask += start;
+  }
+
+  if (clip.yOffset == 0) {
+    blitSprite<blit_mode, true, true>(clip, bitmap, mask, w, col_step, row_jump, flip);
+  } else {
+    blitSprite<blit_mode, false, true>(clip, bitmap, mask, w, col_step, row_jump, flip);
+  }
+}
+
+template<uint8_t drawMode, bool flipped = false>
+static void drawSprite(int16_t x, int16_t y,
+                       const uint8_t *bitmap, uint8_t frame,
+                       const uint8_t *mask, uint8_t sprite_frame,
+                       uint8_t flip = SPRITE_FLIP_NONE)
 {
   unsigned int frame_offset;
 
@@ -58,11 +422,6 @@ void Sprites::draw(int16_t x, int16_t y,
     bitmap += frame * frame_offset;
   }
 
-  // if we're detecting the draw mode then base it on whether a mask
-  // was passed as a separate object
-  if (drawMode == SPRITE_AUTO_MODE) {
-    drawMode = mask == NULL ? SPRITE_UNMASKED : SPRITE_MASKED;
-  }
   // assembly optimisation of above code saving 20(+) bytes
 //  uint8_t width;
 //  uint8_t height;
@@ -122,301 +481,149 @@ void Sprites::draw(int16_t x, int16_t y,
 //      [sprite_masked]    "M" (SPRITE_MASKED)
 //    : "r20", "r21"
 //  );
-  drawBitmap(x, y, bitmap, mask, width, height, drawMode);
+  if (flipped)
+    drawSpriteBitmapFlipped<drawMode>(x, y, bitmap, mask, width, height, flip);
+  else
+    drawSpriteBitmap<drawMode>(x, y, bitmap, mask, width, height);
 }
 
-void Sprites::drawBitmap(int16_t x, int16_t y,
-                         const uint8_t *bitmap, const uint8_t *mask,
-                         uint8_t w, uint8_t h, uint8_t draw_mode)
+void Sprites::drawExternalMask(int16_t x, int16_t y, const uint8_t *bitmap,
+                               const uint8_t *mask, uint8_t frame, uint8_t mask_frame)
 {
-  // no need to draw at all if we're offscreen
-  if (x + w <= 0 || x > WIDTH - 1 || y + h <= 0 || y > HEIGHT - 1)
-    return;
+  drawSprite<SPRITE_MASKED>(x, y, bitmap, frame, mask, mask_frame);
+}
 
-  if (bitmap == NULL)
-    return;
+void Sprites::drawOverwrite(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame)
+{
+  drawSprite<SPRITE_OVERWRITE>(x, y, bitmap, frame, NULL, 0);
+}
 
-  // xOffset technically doesn't need to be 16 bit but the math operations
-  // are measurably faster if it is
-  uint16_t xOffset, ofs;
-  int8_t yOffset = y & 7;
-  int8_t sRow = y / 8;
-  uint8_t loop_h, start_h, rendered_width;
+void Sprites::drawErase(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame)
+{
+  drawSprite<SPRITE_IS_MASK_ERASE>(x, y, bitmap, frame, NULL, 0);
+}
 
-  if (y < 0 && yOffset > 0) {
-    sRow--;
-  }
+void Sprites::drawSelfMasked(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame)
+{
+  drawSprite<SPRITE_IS_MASK>(x, y, bitmap, frame, NULL, 0);
+}
 
-  // if the left side of the render is offscreen skip those loops
-  if (x < 0) {
-    xOffset = abs(x);
-  } else {
-    xOffset = 0;
-  }
+void Sprites::drawPlusMask(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame)
+{
+  drawSprite<SPRITE_PLUS_MASK>(x, y, bitmap, frame, NULL, 0);
+}
 
-  // if the right side of the render is offscreen skip those loops
-  if (x + w > WIDTH - 1) {
-    rendered_width = ((WIDTH - x) - xOffset);
-  } else {
-    rendered_width = (w - xOffset);
-  }
+void Sprites::drawShaded(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame, uint8_t shade)
+{
+  if (Arduboy2Base::shadeColor(shade))
+    drawSprite<SPRITE_IS_MASK>(x, y, bitmap, frame, NULL, 0);
+  else
+    drawSprite<SPRITE_IS_MASK_ERASE>(x, y, bitmap, frame, NULL, 0);
+}
 
-  // if the top side of the render is offscreen skip those loops
-  if (sRow < -1) {
-    start_h = abs(sRow) - 1;
-  } else {
-    start_h = 0;
-  }
+void Sprites::drawGray(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame)
+{
+  drawSprite<SPRITE_OVERWRITE>(x, y, bitmap, frame * 2 + Arduboy2Base::grayPlane(), NULL, 0);
+}
 
-  loop_h = h / 8 + (h % 8 > 0 ? 1 : 0); // divide, then round up
+void Sprites::drawExternalMask(int16_t x, int16_t y, const uint8_t *bitmap,
+                               const uint8_t *mask, uint8_t frame, uint8_t mask_frame,
+                               uint8_t flip)
+{
+  drawSprite<SPRITE_MASKED, true>(x, y, bitmap, frame, mask, mask_frame, flip);
+}
 
-  // if (sRow + loop_h - 1 > (HEIGHT/8)-1)
-  if (sRow + loop_h > (HEIGHT / 8)) {
-    loop_h = (HEIGHT / 8) - sRow;
-  }
+void Sprites::drawOverwrite(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame,
+                            uint8_t flip)
+{
+  drawSprite<SPRITE_OVERWRITE, true>(x, y, bitmap, frame, NULL, 0, flip);
+}
 
-  // prepare variables for loops later so we can compare with 0
-  // instead of comparing two variables
-  loop_h -= start_h;
+void Sprites::drawErase(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame,
+                        uint8_t flip)
+{
+  drawSprite<SPRITE_IS_MASK_ERASE, true>(x, y, bitmap, frame, NULL, 0, flip);
+}
 
-  sRow += start_h;
-  ofs = (sRow * WIDTH) + x + xOffset;
-  uint8_t *bofs = (uint8_t *)bitmap + (start_h * w) + xOffset;
-  uint8_t data;
+void Sprites::drawSelfMasked(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame,
+                             uint8_t flip)
+{
+  drawSprite<SPRITE_IS_MASK, true>(x, y, bitmap, frame, NULL, 0, flip);
+}
 
-  uint8_t mul_amt = 1 << yOffset;
-  uint16_t mask_data;
-  uint16_t bitmap_data;
+void Sprites::drawPlusMask(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame,
+                           uint8_t flip)
+{
+  drawSprite<SPRITE_PLUS_MASK, true>(x, y, bitmap, frame, NULL, 0, flip);
+}
 
-  switch (draw_mode) {
+void Sprites::drawShaded(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame,
+                         uint8_t shade, uint8_t flip)
+{
+  if (Arduboy2Base::shadeColor(shade))
+    drawSprite<SPRITE_IS_MASK, true>(x, y, bitmap, frame, NULL, 0, flip);
+  else
+    drawSprite<SPRITE_IS_MASK_ERASE, true>(x, y, bitmap, frame, NULL, 0, flip);
+}
+
+void Sprites::drawGray(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame,
+                       uint8_t flip)
+{
+  drawSprite<SPRITE_OVERWRITE, true>(x, y, bitmap, frame * 2 + Arduboy2Base::grayPlane(),
+                                     NULL, 0, flip);
+}
+
+
+//common functions
+void Sprites::draw(int16_t x, int16_t y,
+                   const uint8_t *bitmap, uint8_t frame,
+                   const uint8_t *mask, uint8_t sprite_frame,
+                   uint8_t drawMode)
+{
+  // if we're detecting the draw mode then base it on whether a mask
+  // was passed as a separate object
+  if (drawMode == SPRITE_AUTO_MODE) {
+    drawMode = mask == NULL ? SPRITE_UNMASKED : SPRITE_MASKED;
+  }
+
+  switch (drawMode) {
     case SPRITE_UNMASKED:
-      // we only want to mask the 8 bits of our own sprite, so we can
-      // calculate the mask before the start of the loop
-      mask_data = ~(0xFF * mul_amt);
-      // really if yOffset = 0 you have a faster case here that could be
-      // optimized
-      for (uint8_t a = 0; a < loop_h; a++) {
-        for (uint8_t iCol = 0; iCol < rendered_width; iCol++) {
-          bitmap_data = pgm_read_byte(bofs) * mul_amt;
-
-          if (sRow >= 0) {
-            data = Arduboy2Base::sBuffer[ofs];
-            data &= (uint8_t)(mask_data);
-            data |= (uint8_t)(bitmap_data);
-            Arduboy2Base::sBuffer[ofs] = data;
-          }
-          if (yOffset != 0 && sRow < 7) {
-            const size_t index = static_cast<uint16_t>(ofs + WIDTH);
-            data = Arduboy2Base::sBuffer[index];
-            data &= (uint8_t)(mask_data >> 8);
-            data |= (uint8_t)(bitmap_data >> 8);
-            Arduboy2Base::sBuffer[index] = data;
-          }
-          ofs++;
-          bofs++;
-        }
-        sRow++;
-        bofs += w - rendered_width;
-        ofs += WIDTH - rendered_width;
-      }
+      drawSprite<SPRITE_UNMASKED>(x, y, bitmap, frame, mask, sprite_frame);
       break;
-
     case SPRITE_IS_MASK:
-      for (uint8_t a = 0; a < loop_h; a++) {
-        for (uint8_t iCol = 0; iCol < rendered_width; iCol++) {
-          bitmap_data = pgm_read_byte(bofs) * mul_amt;
-          if (sRow >= 0) {
-            Arduboy2Base::sBuffer[ofs] |= (uint8_t)(bitmap_data);
-          }
-          if (yOffset != 0 && sRow < 7) {
-            const size_t index = static_cast<uint16_t>(ofs + WIDTH);
-            Arduboy2Base::sBuffer[index] |= (uint8_t)(bitmap_data >> 8);
-          }
-          ofs++;
-          bofs++;
-        }
-        sRow++;
-        bofs += w - rendered_width;
-        ofs += WIDTH - rendered_width;
-      }
+      drawSprite<SPRITE_IS_MASK>(x, y, bitmap, frame, mask, sprite_frame);
       break;
-
     case SPRITE_IS_MASK_ERASE:
-      for (uint8_t a = 0; a < loop_h; a++) {
-        for (uint8_t iCol = 0; iCol < rendered_width; iCol++) {
-          bitmap_data = pgm_read_byte(bofs) * mul_amt;
-          if (sRow >= 0) {
-            Arduboy2Base::sBuffer[ofs]  &= ~(uint8_t)(bitmap_data);
-          }
-          if (yOffset != 0 && sRow < 7) {
-            const size_t index = static_cast<uint16_t>(ofs + WIDTH);
-            Arduboy2Base::sBuffer[index] &= ~(uint8_t)(bitmap_data >> 8);
-          }
-          ofs++;
-          bofs++;
-        }
-        sRow++;
-        bofs += w - rendered_width;
-        ofs += WIDTH - rendered_width;
-      }
+      drawSprite<SPRITE_IS_MASK_ERASE>(x, y, bitmap, frame, mask, sprite_frame);
       break;
-
     case SPRITE_MASKED:
-      uint8_t *mask_ofs;
-      mask_ofs = (uint8_t *)mask + (start_h * w) + xOffset;
-      for (uint8_t a = 0; a < loop_h; a++) {
-        for (uint8_t iCol = 0; iCol < rendered_width; iCol++) {
-          // NOTE: you might think in the yOffset==0 case that this results
-          // in more effort, but in all my testing the compiler was forcing
-          // 16-bit math to happen here anyways, so this isn't actually
-          // compiling to more code than it otherwise would. If the offset
-          // is 0 the high part of the word will just never be used.
-
-          // load data and bit shift
-          // mask needs to be bit flipped
-          mask_data = ~(pgm_read_byte(mask_ofs) * mul_amt);
-          bitmap_data = pgm_read_byte(bofs) * mul_amt;
-
-          if (sRow >= 0) {
-            data = Arduboy2Base::sBuffer[ofs];
-            data &= (uint8_t)(mask_data);
-            data |= (uint8_t)(bitmap_data);
-            Arduboy2Base::sBuffer[ofs] = data;
-          }
-          if (yOffset != 0 && sRow < 7) {
-            const size_t index = static_cast<uint16_t>(ofs + WIDTH);
-            data = Arduboy2Base::sBuffer[index];
-            data &= (uint8_t)(mask_data >> 8);
-            data |= (uint8_t)(bitmap_data >> 8);
-            Arduboy2Base::sBuffer[index] = data;
-          }
-          ofs++;
-          mask_ofs++;
-          bofs++;
-        }
-        sRow++;
-        bofs += w - rendered_width;
-        mask_ofs += w - rendered_width;
-        ofs += WIDTH - rendered_width;
-      }
+      drawSprite<SPRITE_MASKED>(x, y, bitmap, frame, mask, sprite_frame);
       break;
+    case SPRITE_PLUS_MASK:
+      drawSprite<SPRITE_PLUS_MASK>(x, y, bitmap, frame, mask, sprite_frame);
+      break;
+  }
+}
 
-
+void Sprites::drawBitmap(int16_t x, int16_t y,
+                         const uint8_t *bitmap, const uint8_t *mask,
+                         uint8_t w, uint8_t h, uint8_t draw_mode)
+{
+  switch (draw_mode) {
+    case SPRITE_UNMASKED:
+      drawSpriteBitmap<SPRITE_UNMASKED>(x, y, bitmap, mask, w, h);
+      break;
+    case SPRITE_IS_MASK:
+      drawSpriteBitmap<SPRITE_IS_MASK>(x, y, bitmap, mask, w, h);
+      break;
+    case SPRITE_IS_MASK_ERASE:
+      drawSpriteBitmap<SPRITE_IS_MASK_ERASE>(x, y, bitmap, mask, w, h);
+      break;
+    case SPRITE_MASKED:
+      drawSpriteBitmap<SPRITE_MASKED>(x, y, bitmap, mask, w, h);
+      break;
     case SPRITE_PLUS_MASK:
-      // *2 because we use double the bits (mask + bitmap)
-      bofs = (uint8_t *)(bitmap + ((start_h * w) + xOffset) * 2);
-
-      uint8_t xi = rendered_width; // counter for x loop below
-
-      asm volatile(
-        "push r28\n" // save Y
-        "push r29\n"
-        "movw r28, %[buffer_ofs]\n" // Y = buffer_ofs_2
-        "adiw r28, 63\n" // buffer_ofs_2 = buffer_ofs + 128
-        "adiw r28, 63\n"
-        "adiw r28, 2\n"
-        "loop_y:\n"
-        "loop_x:\n"
-        // load bitmap and mask data
-        "lpm %A[bitmap_data], Z+\n"
-        "lpm %A[mask_data], Z+\n"
-
-        // shift mask and buffer data
-        "tst %[yOffset]\n"
-        "breq skip_shifting\n"
-        "mul %A[bitmap_data], %[mul_amt]\n"
-        "movw %[bitmap_data], r0\n"
-        "mul %A[mask_data], %[mul_amt]\n"
-        "movw %[mask_data], r0\n"
-
-        // SECOND PAGE
-        // if yOffset != 0 && sRow < 7
-        "cpi %[sRow], 7\n"
-        "brge end_second_page\n"
-        // then
-        "ld %[data], Y\n"
-        "com %B[mask_data]\n" // invert high byte of mask
-        "and %[data], %B[mask_data]\n"
-        "or %[data], %B[bitmap_data]\n"
-        // update buffer, increment
-        "st Y+, %[data]\n"
-
-        "end_second_page:\n"
-        "skip_shifting:\n"
-
-        // FIRST PAGE
-        // if sRow >= 0
-        "tst %[sRow]\n"
-        "brmi skip_first_page\n"
-        "ld %[data], %a[buffer_ofs]\n"
-        // then
-        "com %A[mask_data]\n"
-        "and %[data], %A[mask_data]\n"
-        "or %[data], %A[bitmap_data]\n"
-        // update buffer, increment
-        "st %a[buffer_ofs]+, %[data]\n"
-        "jmp end_first_page\n"
-
-        "skip_first_page:\n"
-        // since no ST Z+ when skipped we need to do this manually
-        "adiw %[buffer_ofs], 1\n"
-
-        "end_first_page:\n"
-
-        // "x_loop_next:\n"
-        "dec %[xi]\n"
-        "brne loop_x\n"
-
-        // increment y
-        "next_loop_y:\n"
-        "dec %[yi]\n"
-        "breq finished\n"
-        "mov %[xi], %[x_count]\n" // reset x counter
-        // sRow++;
-        "inc %[sRow]\n"
-        "clr __zero_reg__\n"
-        // sprite_ofs += (w - rendered_width) * 2;
-        "add %A[sprite_ofs], %A[sprite_ofs_jump]\n"
-        "adc %B[sprite_ofs], __zero_reg__\n"
-        // buffer_ofs += WIDTH - rendered_width;
-        "add %A[buffer_ofs], %A[buffer_ofs_jump]\n"
-        "adc %B[buffer_ofs], __zero_reg__\n"
-        // buffer_ofs_page_2 += WIDTH - rendered_width;
-        "add r28, %A[buffer_ofs_jump]\n"
-        "adc r29, __zero_reg__\n"
-
-        "rjmp loop_y\n"
-        "finished:\n"
-        // put the Y register back in place
-        "pop r29\n"
-        "pop r28\n"
-        "clr __zero_reg__\n" // just in case
-        : [xi] "+&a" (xi),
-        [yi] "+&a" (loop_h),
-        [sRow] "+&a" (sRow), // CPI requires an upper register (r16-r23)
-        [data] "=&l" (data),
-        [mask_data] "=&l" (mask_data),
-        [bitmap_data] "=&l" (bitmap_data)
-        :
-        [screen_width] "M" (WIDTH),
-        [x_count] "l" (rendered_width), // lower register
-        [sprite_ofs] "z" (bofs),
-        [buffer_ofs] "x" (Arduboy2Base::sBuffer+ofs),
-        [buffer_ofs_jump] "a" (WIDTH-rendered_width), // upper reg (r16-r23)
-        [sprite_ofs_jump] "a" ((w-rendered_width)*2), // upper reg (r16-r23)
-
-        // [sprite_ofs_jump] "r" (0),
-        [yOffset] "l" (yOffset), // lower register
-        [mul_amt] "l" (mul_amt) // lower register
-        // NOTE: We also clobber r28 and r29 (y) but sometimes the compiler
-        // won't allow us, so in order to make this work we don't tell it
-        // that we clobber them. Instead, we push/pop to preserve them.
-        // Then we need to guarantee that the the compiler doesn't put one of
-        // our own variables into r28/r29.
-        // We do that by specifying all the inputs and outputs use either
-        // lower registers (l) or simple (r16-r23) upper registers (a).
-        : // pushes/clobbers/pops r28 and r29 (y)
-      );
+      drawSpriteBitmap<SPRITE_PLUS_MASK>(x, y, bitmap, mask, w, h);
       break;
   }
 }
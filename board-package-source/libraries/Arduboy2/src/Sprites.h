@@ -243,8 +243,150 @@ class Sprites
      */
     static void drawSelfMasked(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame);
 
-    // Master function. Needs to be abstracted into separate function for
-    // every render type.
+    /** \brief
+     * Draw a sprite in a grayscale shade, using only the bits set to 1.
+     *
+     * \param x,y The coordinates of the top left pixel location.
+     * \param bitmap A pointer to the array containing the image frames.
+     * \param frame The frame number of the image to draw.
+     * \param shade The shade to draw the sprite in: `SHADE_BLACK`,
+     * `SHADE_DARK_GRAY`, `SHADE_LIGHT_GRAY` or `SHADE_WHITE`.
+     *
+     * \details
+     * Used with `Arduboy2Base::displayGray()`. Bits set to 1 in the frame
+     * are drawn like `drawSelfMasked()` if the shade is lit in the bit plane
+     * being drawn, or like `drawErase()` if it isn't. Bits set to 0 in the
+     * frame will remain unchanged in the buffer.
+     *
+     * \see Arduboy2Base::displayGray() Arduboy2Base::shadeColor()
+     */
+    static void drawShaded(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame, uint8_t shade);
+
+    /** \brief
+     * Draw a 4 shade grayscale sprite by replacing the existing content.
+     *
+     * \param x,y The coordinates of the top left pixel location.
+     * \param bitmap A pointer to the array containing the image frames.
+     * \param frame The frame number of the grayscale image to draw.
+     *
+     * \details
+     * Used with `Arduboy2Base::displayGray()`. Each grayscale image is stored
+     * as two frames in the array: first the low bit plane, then the high bit
+     * plane. The plane being drawn is used like `drawOverwrite()`, so frame
+     * `frame` uses the frames `frame * 2` and `frame * 2 + 1` of the array.
+     *
+     * \see Arduboy2Base::displayGray() Arduboy2Base::grayPlane()
+     */
+    static void drawGray(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame);
+
+    /** \brief
+     * Draw a flipped sprite using a separate image and mask array.
+     *
+     * \param x,y The coordinates of the top left pixel location.
+     * \param bitmap A pointer to the array containing the image frames.
+     * \param mask A pointer to the array containing the mask frames.
+     * \param frame The frame number of the image to draw.
+     * \param mask_frame The frame number for the mask to use.
+     * \param flip `SPRITE_FLIP_HORIZONTAL`, `SPRITE_FLIP_VERTICAL`,
+     * `SPRITE_FLIP_BOTH` or `SPRITE_FLIP_NONE`.
+     *
+     * \details
+     * The same as the version without the `flip` parameter, but with the
+     * image and mask mirrored left to right and/or top to bottom. This allows
+     * a single set of frames to be used for a character facing either way.
+     *
+     * A horizontal flip reads the columns of the frame in reverse order. A
+     * vertical flip reads the rows in reverse order and reverses the bits of
+     * each byte.
+     *
+     * The flipped versions of the drawing functions are a bit slower than
+     * the regular ones and only add to the code size when they're used.
+     */
+    static void drawExternalMask(int16_t x, int16_t y, const uint8_t *bitmap,
+                                 const uint8_t *mask, uint8_t frame, uint8_t mask_frame,
+                                 uint8_t flip);
+
+    /** \brief
+     * Draw a flipped sprite using an array containing both image and mask values.
+     *
+     * \param x,y The coordinates of the top left pixel location.
+     * \param bitmap A pointer to the array containing the image/mask frames.
+     * \param frame The frame number of the image to draw.
+     * \param flip The `SPRITE_FLIP_` value to flip the sprite with.
+     *
+     * \see drawExternalMask(int16_t, int16_t, const uint8_t*, const uint8_t*, uint8_t, uint8_t, uint8_t)
+     */
+    static void drawPlusMask(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame,
+                             uint8_t flip);
+
+    /** \brief
+     * Draw a flipped sprite by replacing the existing content completely.
+     *
+     * \param x,y The coordinates of the top left pixel location.
+     * \param bitmap A pointer to the array containing the image frames.
+     * \param frame The frame number of the image to draw.
+     * \param flip The `SPRITE_FLIP_` value to flip the sprite with.
+     *
+     * \see drawExternalMask(int16_t, int16_t, const uint8_t*, const uint8_t*, uint8_t, uint8_t, uint8_t)
+     */
+    static void drawOverwrite(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame,
+                              uint8_t flip);
+
+    /** \brief
+     * "Erase" a flipped sprite.
+     *
+     * \param x,y The coordinates of the top left pixel location.
+     * \param bitmap A pointer to the array containing the image frames.
+     * \param frame The frame number of the image to erase.
+     * \param flip The `SPRITE_FLIP_` value to flip the sprite with.
+     *
+     * \see drawExternalMask(int16_t, int16_t, const uint8_t*, const uint8_t*, uint8_t, uint8_t, uint8_t)
+     */
+    static void drawErase(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame,
+                          uint8_t flip);
+
+    /** \brief
+     * Draw a flipped sprite using only the bits set to 1.
+     *
+     * \param x,y The coordinates of the top left pixel location.
+     * \param bitmap A pointer to the array containing the image frames.
+     * \param frame The frame number of the image to draw.
+     * \param flip The `SPRITE_FLIP_` value to flip the sprite with.
+     *
+     * \see drawExternalMask(int16_t, int16_t, const uint8_t*, const uint8_t*, uint8_t, uint8_t, uint8_t)
+     */
+    static void drawSelfMasked(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame,
+                               uint8_t flip);
+
+    /** \brief
+     * Draw a flipped sprite in a grayscale shade, using only the bits set to 1.
+     *
+     * \param x,y The coordinates of the top left pixel location.
+     * \param bitmap A pointer to the array containing the image frames.
+     * \param frame The frame number of the image to draw.
+     * \param shade The shade to draw the sprite in.
+     * \param flip The `SPRITE_FLIP_` value to flip the sprite with.
+     *
+     * \see drawExternalMask(int16_t, int16_t, const uint8_t*, const uint8_t*, uint8_t, uint8_t, uint8_t)
+     */
+    static void drawShaded(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame,
+                           uint8_t shade, uint8_t flip);
+
+    /** \brief
+     * Draw a flipped 4 shade grayscale sprite by replacing the existing content.
+     *
+     * \param x,y The coordinates of the top left pixel location.
+     * \param bitmap A pointer to the array containing the image frames.
+     * \param frame The frame number of the grayscale image to draw.
+     * \param flip The `SPRITE_FLIP_` value to flip the sprite with.
+     *
+     * \see drawExternalMask(int16_t, int16_t, const uint8_t*, const uint8_t*, uint8_t, uint8_t, uint8_t)
+     */
+    static void drawGray(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame,
+                         uint8_t flip);
+
+    // Master function for a draw mode chosen at run time. The functions
+    // above use a blitter specialized for their draw mode at compile time.
     // (Not officially part of the API)
     static void draw(int16_t x, int16_t y,
                      const uint8_t *bitmap, uint8_t frame,
@@ -7,6 +7,15 @@
 
 #include "SpritesB.h"
 
+// Reverse the bits of a byte to flip it vertically. Computed instead of
+// using bitReverseTable, which would add 256 bytes to every sketch.
+static uint8_t reverseBits(uint8_t b)
+{
+  b = (b << 4) | (b >> 4);
+  b = ((b & 0xCC) >> 2) | ((b & 0x33) << 2);
+  return ((b & 0xAA) >> 1) | ((b & 0x55) << 1);
+}
+
 void SpritesB::drawExternalMask(int16_t x, int16_t y, const uint8_t *bitmap,
                                const uint8_t *mask, uint8_t frame, uint8_t mask_frame)
 {
@@ -33,12 +42,67 @@ void SpritesB::drawPlusMask(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t
   draw(x, y, bitmap, frame, NULL, 0, SPRITE_PLUS_MASK);
 }
 
+void SpritesB::drawShaded(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame, uint8_t shade)
+{
+  draw(x, y, bitmap, frame, NULL, 0,
+       Arduboy2Base::shadeColor(shade) ? SPRITE_IS_MASK : SPRITE_IS_MASK_ERASE);
+}
+
+void SpritesB::drawGray(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame)
+{
+  draw(x, y, bitmap, frame * 2 + Arduboy2Base::grayPlane(), NULL, 0, SPRITE_OVERWRITE);
+}
+
+void SpritesB::drawExternalMask(int16_t x, int16_t y, const uint8_t *bitmap,
+                               const uint8_t *mask, uint8_t frame, uint8_t mask_frame,
+                               uint8_t flip)
+{
+  draw(x, y, bitmap, frame, mask, mask_frame, SPRITE_MASKED, flip);
+}
+
+void SpritesB::drawOverwrite(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame,
+                             uint8_t flip)
+{
+  draw(x, y, bitmap, frame, NULL, 0, SPRITE_OVERWRITE, flip);
+}
+
+void SpritesB::drawErase(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame,
+                         uint8_t flip)
+{
+  draw(x, y, bitmap, frame, NULL, 0, SPRITE_IS_MASK_ERASE, flip);
+}
+
+void SpritesB::drawSelfMasked(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame,
+                              uint8_t flip)
+{
+  draw(x, y, bitmap, frame, NULL, 0, SPRITE_IS_MASK, flip);
+}
+
+void SpritesB::drawPlusMask(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame,
+                            uint8_t flip)
+{
+  draw(x, y, bitmap, frame, NULL, 0, SPRITE_PLUS_MASK, flip);
+}
+
+void SpritesB::drawShaded(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame,
+                          uint8_t shade, uint8_t flip)
+{
+  draw(x, y, bitmap, frame, NULL, 0,
+       Arduboy2Base::shadeColor(shade) ? SPRITE_IS_MASK : SPRITE_IS_MASK_ERASE, flip);
+}
+
+void SpritesB::drawGray(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame,
+                        uint8_t flip)
+{
+  draw(x, y, bitmap, frame * 2 + Arduboy2Base::grayPlane(), NULL, 0, SPRITE_OVERWRITE, flip);
+}
+
 
 //common functions
 void SpritesB::draw(int16_t x, int16_t y,
                    const uint8_t *bitmap, uint8_t frame,
                    const uint8_t *mask, uint8_t sprite_frame,
-                   uint8_t drawMode)
+                   uint8_t drawMode, uint8_t flip)
 {
   unsigned int frame_offset;
 
@@ -65,13 +129,21 @@ void SpritesB::draw(int16_t x, int16_t y,
     drawMode = mask == NULL ? SPRITE_UNMASKED : SPRITE_MASKED;
   }
 
-  drawBitmap(x, y, bitmap, mask, width, height, drawMode);
+  drawBitmap(x, y, bitmap, mask, width, height, drawMode, flip);
 }
 
 void SpritesB::drawBitmap(int16_t x, int16_t y,
                          const uint8_t *bitmap, const uint8_t *mask,
-                         uint8_t w, uint8_t h, uint8_t draw_mode)
+                         uint8_t w, uint8_t h, uint8_t draw_mode, uint8_t flip)
 {
+  if (flip & SPRITE_FLIP_VERTICAL) {
+    // whole pages are flipped, so the unused rows at the bottom of the last
+    // page end up on top. Draw them above y.
+    uint8_t unused = -h & 7;
+    y -= unused;
+    h += unused;
+  }
+
   // no need to draw at all of we're offscreen
   if (x + w <= 0 || x > WIDTH - 1 || y + h <= 0 || y > HEIGHT - 1)
     return;
@@ -79,6 +151,10 @@ void SpritesB::drawBitmap(int16_t x, int16_t y,
   if (bitmap == NULL)
     return;
 
+ #ifdef ARDUBOY_DIRTY_RECT
+  Arduboy2Base::markDirty(x, y, w, h);
+ #endif
+
   // xOffset technically doesn't need to be 16 bit but the math operations
   // are measurably faster if it is
   uint16_t xOffset, ofs;
@@ -130,8 +206,24 @@ void SpritesB::drawBitmap(int16_t x, int16_t y,
   uint16_t bitmap_data;
 
   const uint8_t ofs_step = draw_mode == SPRITE_PLUS_MASK ? 2 : 1;
-  const uint8_t ofs_stride = (w - rendered_width)*ofs_step;
-  const uint16_t initial_bofs = ((start_h * w) + xOffset)*ofs_step;
+
+  // a flipped sprite is read backwards through its columns and/or pages
+  uint8_t page = start_h;
+  uint8_t column = xOffset;
+  int8_t col_step = ofs_step;
+  int16_t page_step = w * ofs_step;
+
+  if (flip & SPRITE_FLIP_HORIZONTAL) {
+    column = w - 1 - column;
+    col_step = -col_step;
+  }
+  if (flip & SPRITE_FLIP_VERTICAL) {
+    page = (h + 7) / 8 - 1 - page;
+    page_step = -page_step;
+  }
+
+  const int16_t ofs_stride = page_step - rendered_width * col_step;
+  const uint16_t initial_bofs = ((page * w) + column)*ofs_step;
 
   const uint8_t *bofs = bitmap + initial_bofs;
   const uint8_t *mask_ofs = !mask ? bitmap : mask;
@@ -140,8 +232,15 @@ void SpritesB::drawBitmap(int16_t x, int16_t y,
   for (uint8_t a = 0; a < loop_h; a++) {
     for (uint8_t iCol = 0; iCol < rendered_width; iCol++) {
       uint8_t data;
+      uint8_t bitmap_byte = pgm_read_byte(bofs);
+      uint8_t mask_byte = pgm_read_byte(mask_ofs);
+
+      if (flip & SPRITE_FLIP_VERTICAL) {
+        bitmap_byte = reverseBits(bitmap_byte);
+        mask_byte = reverseBits(mask_byte);
+      }
 
-      bitmap_data = pgm_read_byte(bofs) * mul_amt;
+      bitmap_data = bitmap_byte * mul_amt;
       mask_data = ~bitmap_data;
 
       if (draw_mode == SPRITE_UNMASKED) {
@@ -149,7 +248,7 @@ void SpritesB::drawBitmap(int16_t x, int16_t y,
       } else if (draw_mode == SPRITE_IS_MASK_ERASE) {
         bitmap_data = 0;
       } else {
-        mask_data = ~(pgm_read_byte(mask_ofs) * mul_amt);
+        mask_data = ~(mask_byte * mul_amt);
       }
 
       if (sRow >= 0) {
@@ -166,8 +265,8 @@ void SpritesB::drawBitmap(int16_t x, int16_t y,
         Arduboy2Base::sBuffer[index] = data;
       }
       ofs++;
-      mask_ofs += ofs_step;
-      bofs += ofs_step;
+      mask_ofs += col_step;
+      bofs += col_step;
     }
     sRow++;
     bofs += ofs_stride;
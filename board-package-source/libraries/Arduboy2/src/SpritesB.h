@@ -99,18 +99,137 @@ class SpritesB
      */
     static void drawSelfMasked(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame);
 
+    /** \brief
+     * Draw a sprite in a grayscale shade, using only the bits set to 1.
+     *
+     * \param x,y The coordinates of the top left pixel location.
+     * \param bitmap A pointer to the array containing the image frames.
+     * \param frame The frame number of the image to draw.
+     * \param shade The shade to draw the sprite in.
+     *
+     * \see Sprites::drawShaded()
+     */
+    static void drawShaded(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame, uint8_t shade);
+
+    /** \brief
+     * Draw a 4 shade grayscale sprite by replacing the existing content.
+     *
+     * \param x,y The coordinates of the top left pixel location.
+     * \param bitmap A pointer to the array containing the image frames.
+     * \param frame The frame number of the grayscale image to draw.
+     *
+     * \see Sprites::drawGray()
+     */
+    static void drawGray(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame);
+
+    /** \brief
+     * Draw a flipped sprite using a separate image and mask array.
+     *
+     * \param x,y The coordinates of the top left pixel location.
+     * \param bitmap A pointer to the array containing the image frames.
+     * \param mask A pointer to the array containing the mask frames.
+     * \param frame The frame number of the image to draw.
+     * \param mask_frame The frame number for the mask to use.
+     * \param flip The `SPRITE_FLIP_` value to flip the sprite with.
+     *
+     * \see Sprites::drawExternalMask(int16_t, int16_t, const uint8_t*, const uint8_t*, uint8_t, uint8_t, uint8_t)
+     */
+    static void drawExternalMask(int16_t x, int16_t y, const uint8_t *bitmap,
+                                 const uint8_t *mask, uint8_t frame, uint8_t mask_frame,
+                                 uint8_t flip);
+
+    /** \brief
+     * Draw a flipped sprite using an array containing both image and mask values.
+     *
+     * \param x,y The coordinates of the top left pixel location.
+     * \param bitmap A pointer to the array containing the image/mask frames.
+     * \param frame The frame number of the image to draw.
+     * \param flip The `SPRITE_FLIP_` value to flip the sprite with.
+     *
+     * \see Sprites::drawPlusMask(int16_t, int16_t, const uint8_t*, uint8_t, uint8_t)
+     */
+    static void drawPlusMask(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame,
+                             uint8_t flip);
+
+    /** \brief
+     * Draw a flipped sprite by replacing the existing content completely.
+     *
+     * \param x,y The coordinates of the top left pixel location.
+     * \param bitmap A pointer to the array containing the image frames.
+     * \param frame The frame number of the image to draw.
+     * \param flip The `SPRITE_FLIP_` value to flip the sprite with.
+     *
+     * \see Sprites::drawOverwrite(int16_t, int16_t, const uint8_t*, uint8_t, uint8_t)
+     */
+    static void drawOverwrite(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame,
+                              uint8_t flip);
+
+    /** \brief
+     * "Erase" a flipped sprite.
+     *
+     * \param x,y The coordinates of the top left pixel location.
+     * \param bitmap A pointer to the array containing the image frames.
+     * \param frame The frame number of the image to erase.
+     * \param flip The `SPRITE_FLIP_` value to flip the sprite with.
+     *
+     * \see Sprites::drawErase(int16_t, int16_t, const uint8_t*, uint8_t, uint8_t)
+     */
+    static void drawErase(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame,
+                          uint8_t flip);
+
+    /** \brief
+     * Draw a flipped sprite using only the bits set to 1.
+     *
+     * \param x,y The coordinates of the top left pixel location.
+     * \param bitmap A pointer to the array containing the image frames.
+     * \param frame The frame number of the image to draw.
+     * \param flip The `SPRITE_FLIP_` value to flip the sprite with.
+     *
+     * \see Sprites::drawSelfMasked(int16_t, int16_t, const uint8_t*, uint8_t, uint8_t)
+     */
+    static void drawSelfMasked(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame,
+                               uint8_t flip);
+
+    /** \brief
+     * Draw a flipped sprite in a grayscale shade, using only the bits set to 1.
+     *
+     * \param x,y The coordinates of the top left pixel location.
+     * \param bitmap A pointer to the array containing the image frames.
+     * \param frame The frame number of the image to draw.
+     * \param shade The shade to draw the sprite in.
+     * \param flip The `SPRITE_FLIP_` value to flip the sprite with.
+     *
+     * \see Sprites::drawShaded(int16_t, int16_t, const uint8_t*, uint8_t, uint8_t, uint8_t)
+     */
+    static void drawShaded(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame,
+                           uint8_t shade, uint8_t flip);
+
+    /** \brief
+     * Draw a flipped 4 shade grayscale sprite by replacing the existing content.
+     *
+     * \param x,y The coordinates of the top left pixel location.
+     * \param bitmap A pointer to the array containing the image frames.
+     * \param frame The frame number of the grayscale image to draw.
+     * \param flip The `SPRITE_FLIP_` value to flip the sprite with.
+     *
+     * \see Sprites::drawGray(int16_t, int16_t, const uint8_t*, uint8_t, uint8_t)
+     */
+    static void drawGray(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame,
+                         uint8_t flip);
+
     // Master function. Needs to be abstracted into separate function for
     // every render type.
     // (Not officially part of the API)
     static void draw(int16_t x, int16_t y,
                      const uint8_t *bitmap, uint8_t frame,
                      const uint8_t *mask, uint8_t sprite_frame,
-                     uint8_t drawMode);
+                     uint8_t drawMode, uint8_t flip = SPRITE_FLIP_NONE);
 
     // (Not officially part of the API)
     static void drawBitmap(int16_t x, int16_t y,
                            const uint8_t *bitmap, const uint8_t *mask,
-                           uint8_t w, uint8_t h, uint8_t draw_mode);
+                           uint8_t w, uint8_t h, uint8_t draw_mode,
+                           uint8_t flip = SPRITE_FLIP_NONE);
 };
 
 #endif
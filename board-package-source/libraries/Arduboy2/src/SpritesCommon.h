@@ -15,4 +15,16 @@
 #define SPRITE_IS_MASK_ERASE 251
 #define SPRITE_AUTO_MODE 255
 
+#define SPRITE_FLIP_NONE 0
+#define SPRITE_FLIP_HORIZONTAL 1
+#define SPRITE_FLIP_VERTICAL 2
+#define SPRITE_FLIP_BOTH 3
+
+#include <avr/pgmspace.h>
+
+// Table in program memory of each byte value with its bits reversed
+// (bit 0 swapped with bit 7 and so on). Used to draw images flipped
+// vertically. (Not officially part of the API)
+extern const uint8_t bitReverseTable[256] PROGMEM;
+
 #endif
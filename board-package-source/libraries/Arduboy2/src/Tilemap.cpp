@@ -0,0 +1,145 @@
+/**
+ * @file Tilemap.cpp
+ * \brief
+ * A class for drawing a scrolling map of tiles as the screen background.
+ */
+
+#include "Tilemap.h"
+
+// Source of the screen bytes for the part of a page covered by one tile
+struct TileStrip
+{
+  const uint8_t *data; // tile byte of the first column drawn
+  int8_t step;         // 1, or -1 for a tile flipped left to right
+  bool flipV;          // bytes have to be bit reversed
+};
+
+// Used for the parts of the screen outside of the map
+static const uint8_t PROGMEM emptyStrip[16] = { 0 };
+
+// Find the tile data of the 8 pixel high strip `strip` of the map at map
+// pixel column `column`. Tiles are (8 << (tileShift - 3)) pixels square.
+static void findStrip(const uint8_t *map, const uint8_t *tiles,
+                      uint8_t tileShift, int16_t column, int16_t strip,
+                      TileStrip& s)
+{
+  uint8_t mapWidth = pgm_read_byte(map);
+  uint8_t mapHeight = pgm_read_byte(map + 1);
+  int16_t tileX = column >> tileShift;
+  int16_t tileY = strip >> (tileShift - 3);
+
+  s.step = 1;
+  s.flipV = false;
+
+  if (tileX < 0 || tileY < 0 || tileX >= mapWidth || tileY >= mapHeight) {
+    s.data = emptyStrip;
+    return;
+  }
+
+  uint8_t entry = pgm_read_byte(map + 2 + (uint16_t)tileY * mapWidth + tileX);
+  uint8_t size = 1 << tileShift;
+  uint8_t col = column & (size - 1);
+  uint8_t page = strip & ((size >> 3) - 1);
+
+  if (entry & TILE_FLIP_H) {
+    col = size - 1 - col;
+    s.step = -1;
+  }
+  if (entry & TILE_FLIP_V) {
+    page = (size >> 3) - 1 - page;
+    s.flipV = true;
+  }
+
+  s.data = tiles + 2 + (entry & TILE_INDEX_MASK) * (uint16_t)(size * (size >> 3))
+           + page * size + col;
+}
+
+static inline uint8_t readStrip(TileStrip& s)
+{
+  uint8_t data = pgm_read_byte(s.data);
+  s.data += s.step;
+  if (s.flipV) {
+    data = pgm_read_byte(&bitReverseTable[data]);
+  }
+  return data;
+}
+
+void Tilemap::draw(int16_t x, int16_t y, const uint8_t *map, const uint8_t *tiles)
+{
+ #ifdef ARDUBOY_DIRTY_RECT
+  Arduboy2Base::markDirty(0, 0, WIDTH, HEIGHT);
+ #endif
+
+  uint8_t tileShift = (pgm_read_byte(tiles) == 16) ? 4 : 3;
+  uint8_t tileMask = (1 << tileShift) - 1;
+  uint8_t yOffset = y & 7;
+  // multiplying by this moves a byte up by (8 - yOffset) bits into the
+  // high byte of the result and down by yOffset bits in the low byte
+  uint8_t mul_amt = 1 << (8 - yOffset);
+  int16_t strip = y >> 3;
+  uint8_t *buffer = Arduboy2Base::sBuffer;
+  TileStrip upper, lower;
+
+  for (uint8_t page = 0; page < HEIGHT / 8; page++, strip++) {
+    int16_t column = x;
+    uint8_t sx = 0;
+
+    do {
+      // the columns up to the next tile boundary come from the same tiles
+      uint8_t run = tileMask + 1 - (column & tileMask);
+      if (run > WIDTH - sx) {
+        run = WIDTH - sx;
+      }
+
+      findStrip(map, tiles, tileShift, column, strip, upper);
+
+      if (yOffset == 0) {
+        // page aligned: the tile bytes are copied as they are
+        if (upper.step == 1 && !upper.flipV) {
+          memcpy_P(buffer, upper.data, run);
+          buffer += run;
+        }
+        else {
+          for (uint8_t i = run; i; i--) {
+            *buffer++ = readStrip(upper);
+          }
+        }
+      }
+      else {
+        // each screen byte is the lower part of the strip above and the
+        // upper part of the strip below it
+        findStrip(map, tiles, tileShift, column, strip + 1, lower);
+
+        if (upper.step == 1 && lower.step == 1 && !upper.flipV && !lower.flipV) {
+          const uint8_t *upperData = upper.data;
+          const uint8_t *lowerData = lower.data;
+          for (uint8_t i = run; i; i--) {
+            uint16_t upperShifted = pgm_read_byte(upperData++) * mul_amt;
+            uint16_t lowerShifted = pgm_read_byte(lowerData++) * mul_amt;
+            *buffer++ = (upperShifted >> 8) | (uint8_t)lowerShifted;
+          }
+        }
+        else {
+          for (uint8_t i = run; i; i--) {
+            uint16_t upperShifted = readStrip(upper) * mul_amt;
+            uint16_t lowerShifted = readStrip(lower) * mul_amt;
+            *buffer++ = (upperShifted >> 8) | (uint8_t)lowerShifted;
+          }
+        }
+      }
+
+      sx += run;
+      column += run;
+    } while (sx < WIDTH);
+  }
+}
+
+uint8_t Tilemap::getTile(const uint8_t *map, int16_t tileX, int16_t tileY)
+{
+  uint8_t mapWidth = pgm_read_byte(map);
+
+  if (tileX < 0 || tileY < 0 || tileX >= mapWidth || tileY >= pgm_read_byte(map + 1)) {
+    return 0;
+  }
+  return pgm_read_byte(map + 2 + (uint16_t)tileY * mapWidth + tileX);
+}
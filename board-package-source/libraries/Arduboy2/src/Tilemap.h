@@ -0,0 +1,107 @@
+/**
+ * @file Tilemap.h
+ * \brief
+ * A class for drawing a scrolling map of tiles as the screen background.
+ */
+
+#ifndef Tilemap_h
+#define Tilemap_h
+
+#include "Arduboy2.h"
+#include "SpritesCommon.h"
+
+/** \brief
+ * Map entry flag to draw a tile mirrored left to right.
+ *
+ * \see Tilemap TILE_FLIP_V TILE_INDEX_MASK
+ */
+#define TILE_FLIP_H 0x40
+
+/** \brief
+ * Map entry flag to draw a tile mirrored top to bottom.
+ *
+ * \see Tilemap TILE_FLIP_H TILE_INDEX_MASK
+ */
+#define TILE_FLIP_V 0x80
+
+/** \brief
+ * The bits of a map entry holding the tile number.
+ *
+ * \see Tilemap TILE_FLIP_H TILE_FLIP_V
+ */
+#define TILE_INDEX_MASK 0x3F
+
+/** \brief
+ * A class for drawing a scrolling map of tiles as the screen background.
+ *
+ * \details
+ * The functions in this class fill the whole screen buffer with a part of a
+ * map made of 8x8 or 16x16 pixel tiles. Both the map and the tiles are
+ * located in program memory. Sprites and other drawing are then done on top
+ * of the background.
+ *
+ * The tile array uses the same format as a `Sprites` image array: the width
+ * and height of a tile in pixels, which must both be 8 or both be 16,
+ * followed by the image data of each tile as a frame. A tile set can so also
+ * be drawn with the `Sprites` functions.
+ *
+ * The map array begins with its width and height in tiles, followed by one
+ * byte for each tile, a row at a time from left to right, top to bottom.
+ * The lower 6 bits of a map byte are the number of the tile (0 to 63).
+ * `TILE_FLIP_H` and `TILE_FLIP_V` can be added to draw the tile mirrored.
+ *
+ * \code{.cpp}
+ * const uint8_t PROGMEM level[] = {
+ *   32, 8, // 32 tiles wide, 8 tiles high
+ *   0, 0, 1, 1 | TILE_FLIP_H, 0, ...
+ * };
+ * \endcode
+ *
+ * Instead of drawing each tile as a sprite, the screen is built a byte at a
+ * time. When the scroll position is a multiple of 8 pixels vertically the
+ * tile data is copied directly, otherwise each screen byte is made from the
+ * two tile bytes above and below it with a single shift.
+ *
+ * \note
+ * This class isn't included by `Arduboy2.h`. A sketch using it must add
+ * `#include <Tilemap.h>` after `#include <Arduboy2.h>`.
+ *
+ * \see Sprites TILE_FLIP_H TILE_FLIP_V
+ */
+class Tilemap
+{
+  public:
+    /** \brief
+     * Fill the screen buffer with a part of a tile map.
+     *
+     * \param x,y The position in the map, in pixels, to be shown at the
+     * top left of the screen.
+     * \param map A pointer to the map array.
+     * \param tiles A pointer to the tile array.
+     *
+     * \details
+     * The position can be any value, including negative values. The parts of
+     * the screen that are outside of the map are cleared.
+     *
+     * Because every byte of the screen buffer is written, there's no need to
+     * clear the buffer before calling this function.
+     */
+    static void draw(int16_t x, int16_t y, const uint8_t *map, const uint8_t *tiles);
+
+    /** \brief
+     * Get the map entry of a tile.
+     *
+     * \param map A pointer to the map array.
+     * \param tileX,tileY The column and row of the tile in the map.
+     *
+     * \return The map entry, including the flip flags, or 0 if the tile is
+     * outside the map.
+     *
+     * \details
+     * This can be used to test what a player is standing on or walking into.
+     * Divide a pixel position by the tile size to get the tile column and row.
+     */
+    static uint8_t getTile(const uint8_t *map, int16_t tileX, int16_t tileY);
+};
+
+#endif
@@ -26,13 +26,12 @@
 
 #define MAX_BALLS 55                   // 55 Balls possible at 60fps 155 at 30fps
 #define CIRCLE_POINTS 84               
-#define VISABLE_TILES_PER_COLUMN 5     // the maximum number of tiles visable horizontally
-#define VISABLE_TILES_PER_ROW 9        // the maximum number of tiles visable vertically
 
 //datafile offsets
 constexpr uint8_t ballWidth = 16;
 constexpr uint8_t ballHeight = 16;
 constexpr uint8_t tilemapWidth = 16;   // number of tiles in a tilemap row
+constexpr uint8_t tilemapHeight = 16;  // number of tile rows in the tilemap
 constexpr uint8_t tileWidth  = 16;
 constexpr uint8_t tileHeight = 16;
 
@@ -81,8 +80,6 @@ void setup() {
   }                                     
 }
 
-uint8_t tilemapBuffer[VISABLE_TILES_PER_ROW]; // a small buffer to store one horizontal row of tiles from the tilemap
-
 void loop() {
   if (!arduboy.nextFrame()) return;
 
@@ -98,24 +95,12 @@ void loop() {
   camera.y = mapLocation.y + circlePoints[pos].y;
   
   //draw tilemap
-  for (int8_t y = 0; y < VISABLE_TILES_PER_COLUMN; y++)
-  {
-    FX::readDataArray(FX_DATA_TILEMAP,           // read the visible tiles on a row from the tilemap in external flash
-                      y + camera.y / tileHeight, // the tilemap row
-                      camera.x / tileWidth,      // the column within tilemap row
-                      tilemapWidth,              // use the width of tilemap as array element size
-                      tilemapBuffer,             // reading tiles into a small buffer is faster then reading each tile individually
-                      VISABLE_TILES_PER_ROW);
-
-    for (uint8_t x = 0; x < VISABLE_TILES_PER_ROW; x++)
-    {
-      FX::drawBitmap(x * tileWidth - camera.x % tileWidth,   // we're substracting the tile width and height modulus for scrolling effect
-                     y * tileHeight - camera.y % tileHeight, //
-                     FX_DATA_TILES,                          // the tilesheet bitmap offset in external flash
-                     tilemapBuffer[x],                       // tile index
-                     dbmNormal);                             // draw a row of normal tiles
-    }
-  }
+  FX::drawTilemap(camera.x,          // the map position shown at the top left of the screen
+                  camera.y,          //
+                  FX_DATA_TILEMAP,   // the tilemap offset in external flash
+                  tilemapWidth,      // the number of tiles in a tilemap row
+                  tilemapHeight,     // the number of tile rows in the tilemap
+                  FX_DATA_TILES);    // the tilesheet bitmap offset in external flash. Only the visible part of the tilemap is read
   if (arduboy.notPressed(UP_BUTTON | DOWN_BUTTON | LEFT_BUTTON | RIGHT_BUTTON)) pos = ++pos % CIRCLE_POINTS; //only circle around when no directional buttons are pressed
   
   //draw balls
@@ -0,0 +1,97 @@
+/* *****************************************************************************
+ * Flash cart read benchmark
+ * *****************************************************************************
+ *
+ * Measures how fast data can be read from the flash cart. No data file is
+ * needed, the benchmark reads from the start of the flash memory.
+ *
+ * Build it once as is and once with FX_FAST_READ defined in ArduboyFX.h to
+ * compare the Read and Fast Read commands. The results are updated every
+ * second:
+ *
+ * stream: the number of bytes read per second by a single long read
+ * seek:   the time in microseconds to read a single byte from a new
+ *         address, which includes sending the command and address
+ * value:  the time in microseconds for a readIndexedUInt16() lookup
+ *         (with FX_CACHE_LINES defined these mostly come from the cache)
+ *
+ * This example is in the public domain.
+ */
+
+#include <Arduboy2.h>
+#include <ArduboyFX.h>
+
+constexpr uint16_t streamBlocks = 32;  // 256 byte blocks read by the stream test
+constexpr uint16_t seeks = 256;        // reads done by the seek and value tests
+
+Arduboy2 arduboy;
+
+uint8_t buffer[256];
+
+unsigned long streamRate;
+unsigned long seekTime;
+unsigned long valueTime;
+
+void setup()
+{
+  arduboy.begin();
+  FX::disableOLED(); // OLED must be disabled before cart can be used
+  FX::begin();       // no program data: reads start at the beginning of the flash
+}
+
+void measure()
+{
+  // one read command for all blocks
+  unsigned long start = micros();
+  FX::seekData(0);
+  for (uint16_t i = 0; i < streamBlocks; i++)
+  {
+    FX::readBytes(buffer, sizeof(buffer));
+  }
+  FX::readEnd();
+  // bytes * 1000000 / us would overflow 32 bits: scale both by 1 / 64
+  streamRate = streamBlocks * sizeof(buffer) * (1000000UL / 64) / ((micros() - start) / 64);
+
+  // a read command for each byte, spread over the flash
+  start = micros();
+  for (uint16_t i = 0; i < seeks; i++)
+  {
+    FX::seekData((uint24_t)i * 331);
+    buffer[0] = FX::readEnd();
+  }
+  seekTime = (micros() - start) / seeks;
+
+  start = micros();
+  for (uint16_t i = 0; i < seeks; i++)
+  {
+    buffer[i & 0xFF] = FX::readIndexedUInt16(0, i);
+  }
+  valueTime = (micros() - start) / seeks;
+}
+
+void loop()
+{
+  measure();
+
+  arduboy.clear();
+ #ifdef FX_FAST_READ
+  arduboy.println(F("Fast Read (0x0B)"));
+ #else
+  arduboy.println(F("Read (0x03)"));
+ #endif
+  arduboy.print(F("stream: "));
+  arduboy.print(streamRate / 1024);
+  arduboy.println(F(" kB/s"));
+  arduboy.print(F("seek:   "));
+  arduboy.print(seekTime);
+  arduboy.println(F(" us"));
+  arduboy.print(F("value:  "));
+  arduboy.print(valueTime);
+  arduboy.println(F(" us"));
+
+  FX::enableOLED(); // only enable OLED for updating the display
+  arduboy.display();
+  FX::disableOLED();
+
+  arduboy.delayShort(1000);
+}
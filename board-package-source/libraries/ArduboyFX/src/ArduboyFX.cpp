@@ -3,6 +3,31 @@
 
 uint16_t FX::programDataPage; // program read only data location in flash memory
 uint16_t FX::programSavePage; // program read and write data location in flash memory
+FXSprite* FX::spriteQueue;      // sprites queued by queueSprite()
+uint8_t FX::spriteQueueSize;    // number of sprites that fit the queue
+uint8_t FX::spriteCount;        // number of sprites in the queue
+#ifdef FX_WRITE_QUEUE
+uint8_t FX::writeState;         // state of the last erase or program command
+FXWrite FX::writeQueue[FX_WRITE_QUEUE_SIZE]; // commands queued for writeUpdate()
+uint8_t FX::writeFirst;         // next queued command
+uint8_t FX::writeCount;         // number of queued commands
+#endif
+uint8_t FX::storeBlocks;        // blocks used by the record store
+uint8_t FX::storeHead;          // block records are appended to
+uint16_t FX::storeSequence;     // sequence number of the head block
+uint16_t FX::storeOffset;       // where the next record goes in the head block
+uint16_t FX::storeIndex[FX_STORE_KEYS]; // where the last record of each key is
+#ifdef FX_CACHE_LINES
+FXCacheLine FX::cache[FX_CACHE_LINES]; // lines of the read cache
+uint16_t FX::cacheHits;         // cache lines found in RAM
+uint16_t FX::cacheMisses;       // cache lines read from flash
+#endif
+#ifdef FX_ASYNC_READ
+uint24_t FX::asyncAddress;      // program data address of the next byte of readAsync()
+uint8_t* FX::asyncBuffer;       // where the next byte of readAsync() goes
+size_t FX::asyncLength;         // bytes left to read by readAsync()
+void (*FX::asyncDone)();        // called when readAsync() has completed
+#endif
 
 
 uint8_t FX::writeByte(uint8_t data)
@@ -71,8 +96,7 @@ void FX::readJedecID(JedecID* id)
 
 bool FX::detect()
 {
-  seekCommand(SFC_READ, 0);
-  SPDR = 0;
+  seekRead(0);
   return readPendingLastUInt16() == 0x4152;
 }
 
@@ -116,6 +140,120 @@ void FX::writeEnable()
 }
 
 
+// Status reads and the erase and program state machine select the flash
+// without enable(), which would call writeWait() again with FX_WRITE_QUEUE.
+static uint8_t readStatus(uint8_t command)
+{
+  FX_PORT &= ~(1 << FX_BIT);
+  FX::writeByte(command);
+  uint8_t status = FX::readByte();
+  FX::disable();
+  return status;
+}
+
+
+static void flashCommand(uint8_t command)
+{
+  FX_PORT &= ~(1 << FX_BIT);
+  FX::writeByte(command);
+  FX::disable();
+}
+
+
+void FX::waitWhileBusy()
+{
+  while (readStatus(SFC_READSTATUS1) & 1); // BUSY bit, also for commands sent without writeState
+ #ifdef FX_WRITE_QUEUE
+  do
+  {
+    writeUpdate();
+  }
+  while (writeBusy());
+ #endif
+}
+
+
+#ifdef FX_WRITE_QUEUE
+void FX::writeWait()
+{
+  if (writeState == wsSuspended) return; // reading is allowed
+  if (writeState == wsErasingQueued)
+  {
+    flashCommand(SFC_ERASE_SUSPEND);
+  }
+  while (readStatus(SFC_READSTATUS1) & 1); // suspended within 20us, or done
+  // SUS bit tells a suspended erase from a completed one
+  writeState = (writeState == wsErasingQueued && (readStatus(SFC_READSTATUS2) & 0x80)) ? wsSuspended : wsIdle;
+}
+
+
+void FX::writeUpdate()
+{
+  if (writeState == wsSuspended)
+  {
+    flashCommand(SFC_ERASE_RESUME);
+    writeState = wsErasingQueued;
+    return;
+  }
+  if (writeState != wsIdle)
+  {
+    if (readStatus(SFC_READSTATUS1) & 1) return;
+    writeState = wsIdle;
+  }
+  if (writeCount == 0) return;
+
+  FXWrite& write = writeQueue[writeFirst];
+  uint24_t address = (uint24_t)(programSavePage + write.page) << 8;
+  flashCommand(SFC_WRITE_ENABLE);
+  FX_PORT &= ~(1 << FX_BIT);
+  writeByte(write.buffer ? SFC_WRITE : SFC_ERASE);
+  writeByte(address >> 16);
+  writeByte(address >> 8);
+  writeByte(address);
+  if (write.buffer)
+  {
+    uint8_t i = 0;
+    do
+    {
+      writeByte(write.buffer[i]);
+    }
+    while (++i);
+    writeState = wsProgramming;
+  }
+  else
+  {
+    writeState = wsErasingQueued;
+  }
+  disable();
+  writeFirst = (writeFirst + 1) % FX_WRITE_QUEUE_SIZE;
+  writeCount--;
+}
+
+
+static bool queueWrite(uint16_t page, const uint8_t* buffer)
+{
+  if (FX::writeCount == FX_WRITE_QUEUE_SIZE) return false;
+  FXWrite& write = FX::writeQueue[(FX::writeFirst + FX::writeCount) % FX_WRITE_QUEUE_SIZE];
+  write.page = page;
+  write.buffer = buffer;
+  FX::writeCount++;
+  return true;
+}
+
+
+bool FX::queueEraseSaveBlock(uint16_t page)
+{
+  return queueWrite(page, nullptr);
+}
+
+
+bool FX::queueWriteSavePage(uint16_t page, const uint8_t* buffer)
+{
+  return queueWrite(page, buffer);
+}
+#endif
+
+
 void FX::seekCommand(uint8_t command, uint24_t address)
 {
   enable();
@@ -126,6 +264,16 @@ void FX::seekCommand(uint8_t command, uint24_t address)
 }
 
 
+void FX::seekRead(uint24_t address)
+{
+  seekCommand(SFC_READ_DATA, address);
+ #ifdef FX_FAST_READ
+  writeByte(0); // dummy byte
+ #endif
+  SPDR = 0;
+}
+
+
 void FX::seekData(uint24_t address)
 {
  #ifdef ARDUINO_ARCH_AVR
@@ -141,8 +289,7 @@ void FX::seekData(uint24_t address)
  #else // C++ version for non AVR platforms
   address += (uint24_t)programDataPage << 8;
  #endif
-  seekCommand(SFC_READ, address);
-  SPDR = 0;
+  seekRead(address);
 }
 
 
@@ -188,8 +335,7 @@ void FX::seekSave(uint24_t address)
  #else // C++ version for non AVR platforms
   address += (uint24_t)programSavePage << 8;
  #endif
-  seekCommand(SFC_READ, address);
-  SPDR = 0;
+  seekRead(address);
 }
 
 
@@ -377,6 +523,33 @@ void FX::readDataBytes(uint24_t address, uint8_t* buffer, size_t length)
 }
 
 
+#ifdef FX_ASYNC_READ
+void FX::readAsync(uint24_t address, uint8_t* buffer, size_t length, void (*done)())
+{
+  if (busy()) readAsyncUpdate(asyncLength); // one read at a time
+  asyncAddress = address;
+  asyncBuffer = buffer;
+  asyncLength = length;
+  asyncDone = done;
+  if (length == 0 && done) done();
+}
+
+
+// Each burst seeks to its first byte and deselects the flash after its last
+// one, so the SPI bus is free between bursts.
+void FX::readAsyncUpdate(size_t maxBytes)
+{
+  if (asyncLength == 0 || maxBytes == 0) return;
+  size_t length = (asyncLength < maxBytes) ? asyncLength : maxBytes;
+  readDataBytes(asyncAddress, asyncBuffer, length);
+  asyncAddress += length;
+  asyncBuffer += length;
+  asyncLength -= length;
+  if (asyncLength == 0 && asyncDone) asyncDone();
+}
+#endif
+
+
 void FX::readSaveBytes(uint24_t address, uint8_t* buffer, size_t length)
 {
   seekSave(address);
@@ -386,14 +559,23 @@ void FX::readSaveBytes(uint24_t address, uint8_t* buffer, size_t length)
 
 void  FX::eraseSaveBlock(uint16_t page)
 {
+ #ifdef FX_WRITE_QUEUE
+  waitWhileBusy(); // a suspended erase must complete first
+ #endif
   writeEnable();
   seekCommand(SFC_ERASE, (uint24_t)(programSavePage + page) << 8);
   disable();
+ #ifdef FX_WRITE_QUEUE
+  writeState = wsErasing; // the next flash access waits for the erase
+ #endif
 }
 
 
 void FX::writeSavePage(uint16_t page, uint8_t* buffer)
 {
+ #ifdef FX_WRITE_QUEUE
+  waitWhileBusy(); // a suspended erase must complete first
+ #endif
   writeEnable();
   seekCommand(SFC_WRITE, (uint24_t)(programSavePage + page) << 8);
   uint8_t i = 0;
@@ -403,8 +585,344 @@ void FX::writeSavePage(uint16_t page, uint8_t* buffer)
   }
   while (i++ < 255);
   disable();
+ #ifdef FX_WRITE_QUEUE
+  writeState = wsProgramming; // the next flash access waits for the program
+ #endif
+}
+
+// The record store is a log of records in 4K blocks of the save area:
+//
+// block:  'L', sequence (16 bit big endian), check byte, move complete byte,
+//         records, erased flash
+// record: key, size, size bytes of data, CRC-16 of key, size and data
+//
+// Records are only appended, so a save programs a few bytes of erased flash.
+// Bytes are programmed in order and a check value is never 0xFF or 0xFFFF,
+// so a write cut short by a power loss is always found to be invalid.
+//
+// The blocks are used in turn and the newest block has the highest sequence
+// number. The block after the newest is always kept erased. When the newest
+// block is full the erased block becomes the newest, the records of the
+// oldest block that haven't been replaced are copied to it, its move complete
+// byte is programmed to 0 and the oldest block is erased. Records are only
+// appended after that, so a newest block without the byte only holds copies.
+//
+// beginStore() reads all records once to find where the last record of each
+// key is. This index is kept up to date by saveRecord() and the moves, so
+// loading a record or finding the records to move doesn't search the flash.
+// A location is block * 4096 + offset in 16 bits, so the store has at most
+// 16 blocks. Offset 0 is a header, so location 0 means there's no record.
+
+constexpr uint16_t storeBlockSize = 4096;
+constexpr uint8_t storeMaxBlocks = 16;
+constexpr uint8_t storeMagic = 'L';
+constexpr uint8_t storeHeaderSize = 4;
+constexpr uint8_t storeFirstRecord = storeHeaderSize + 1; // after the move complete byte
+constexpr uint8_t recordOverhead = 4; // key, size and CRC
+
+static uint16_t crc16(uint16_t crc, uint8_t data)
+{
+  crc ^= (uint16_t)data << 8;
+  for (uint8_t i = 0; i < 8; i++)
+  {
+    crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+
+static inline uint16_t crc16End(uint16_t crc) // erased flash is never valid
+{
+  return (crc == 0xFFFF) ? 0xFFFE : crc;
+}
+
+
+static inline uint24_t storeAddress(uint8_t block, uint16_t offset)
+{
+  return ((uint24_t)block << 12) + offset;
+}
+
+
+// Program bytes to the save area in order. A program command can't cross a
+// page, so each page gets its own command.
+static uint24_t programAddress;
+static bool programming;
+
+static void programStart(uint24_t address)
+{
+  FX::waitWhileBusy(); // a suspended erase must complete first
+  programAddress = address + ((uint24_t)FX::programSavePage << 8);
+  programming = false;
+}
+
+
+static void programEnd()
+{
+  FX::disable();
+  FX::waitWhileBusy();
+  programming = false;
+}
+
+
+static void programBytes(const uint8_t* data, uint8_t length)
+{
+  for (; length; length--)
+  {
+    if (!programming || (programAddress & 0xFF) == 0)
+    {
+      if (programming) programEnd();
+      FX::writeEnable();
+      FX::seekCommand(SFC_WRITE, programAddress);
+      programming = true;
+    }
+    FX::writeByte(*data++);
+    programAddress++;
+  }
+}
+
+
+static void eraseStoreBlock(uint8_t block)
+{
+  FX::eraseSaveBlock((uint16_t)block << 4);
+  FX::waitWhileBusy();
+}
+
+
+static inline uint8_t storeCheck(const uint8_t* header)
+{
+  uint8_t check = crc16(crc16(crc16(0xFFFF, header[0]), header[1]), header[2]);
+  return (check == 0xFF) ? 0xFE : check;
+}
+
+
+static bool readStoreHeader(uint8_t block, uint16_t& sequence)
+{
+  uint8_t header[storeHeaderSize];
+  FX::readSaveBytes(storeAddress(block, 0), header, storeHeaderSize);
+  sequence = ((uint16_t)header[1] << 8) | header[2];
+  return header[0] == storeMagic && header[3] == storeCheck(header);
+}
+
+
+// An erase cut short can leave any bytes of the block programmed, so all
+// of them are checked.
+static bool storeBlockErased(uint8_t block)
+{
+  uint8_t erased = 0xFF;
+  FX::seekSave(storeAddress(block, 0));
+  for (uint16_t i = storeBlockSize - 1; i; i--) erased &= FX::readPendingUInt8();
+  erased &= FX::readEnd();
+  return erased == 0xFF;
+}
+
+
+static void writeStoreHeader(uint8_t block, uint16_t sequence)
+{
+  uint8_t header[storeHeaderSize] = { storeMagic, (uint8_t)(sequence >> 8), (uint8_t)sequence, 0 };
+  header[3] = storeCheck(header);
+  programStart(storeAddress(block, 0));
+  programBytes(header, storeHeaderSize);
+  programEnd();
+}
+
+
+static bool storeMoved(uint8_t block)
+{
+  uint8_t moved;
+  FX::readSaveBytes(storeAddress(block, storeHeaderSize), &moved, 1);
+  return moved != 0xFF; // any programmed bit means all copies were made
+}
+
+
+static void markStoreMoved(uint8_t block)
+{
+  uint8_t moved = 0;
+  programStart(storeAddress(block, storeHeaderSize));
+  programBytes(&moved, 1);
+  programEnd();
+}
+
+
+// Check the record at offset of block. Returns the size of the record
+// including key, size and CRC, or 0 if there's no valid record. key and
+// size are read even then, both are FX_STORE_NO_KEY if the flash is erased.
+static uint16_t readStoreRecord(uint8_t block, uint16_t offset, uint8_t& key, uint8_t& size)
+{
+  key = size = FX_STORE_NO_KEY;
+  if (offset + recordOverhead > storeBlockSize) return 0;
+  FX::seekSave(storeAddress(block, offset));
+  key = FX::readPendingUInt8();
+  size = FX::readPendingUInt8();
+  uint16_t length = recordOverhead + size;
+  if (key == FX_STORE_NO_KEY || offset + length > storeBlockSize)
+  {
+    FX::readEnd();
+    return 0;
+  }
+  uint16_t crc = crc16(crc16(0xFFFF, key), size);
+  for (uint8_t i = size; i; i--) crc = crc16(crc, FX::readPendingUInt8());
+  uint16_t check = FX::readPendingUInt16();
+  FX::readEnd();
+  return (check == crc16End(crc)) ? length : 0;
+}
+
+
+// Add the records of block to the index. Returns the offset after the last
+// valid record. A record cut short by a power loss leaves programmed bytes
+// that can't be written again, so the block is then full.
+static uint16_t indexStoreBlock(uint8_t block)
+{
+  uint16_t offset = storeFirstRecord;
+  uint16_t length;
+  uint8_t key, size;
+  while ((length = readStoreRecord(block, offset, key, size)) != 0)
+  {
+    if (key < FX_STORE_KEYS) FX::storeIndex[key] = storeAddress(block, offset);
+    offset += length;
+  }
+  return (key != FX_STORE_NO_KEY || size != FX_STORE_NO_KEY) ? storeBlockSize : offset;
+}
+
+
+// Copy the records of block that are still the last ones for their key to
+// the head block, mark the head as complete and erase block.
+static void compactStoreBlock(uint8_t block)
+{
+  uint16_t sequence;
+  if (readStoreHeader(block, sequence))
+  {
+    uint16_t offset = storeFirstRecord;
+    uint16_t length;
+    uint8_t key, size;
+    while ((length = readStoreRecord(block, offset, key, size)) != 0)
+    {
+      if (key < FX_STORE_KEYS && FX::storeIndex[key] == storeAddress(block, offset))
+      {
+        FX::storeIndex[key] = 0;
+        if (FX::storeOffset + length <= storeBlockSize)
+        {
+          // copy the record as it is
+          uint8_t buffer[32];
+          programStart(storeAddress(FX::storeHead, FX::storeOffset));
+          for (uint16_t copied = 0; copied < length; )
+          {
+            uint8_t count = (length - copied > (uint16_t)sizeof(buffer)) ? sizeof(buffer) : length - copied;
+            if (programming) programEnd(); // the flash can't read while programming
+            FX::readSaveBytes(storeAddress(block, offset + copied), buffer, count);
+            programBytes(buffer, count);
+            copied += count;
+          }
+          programEnd();
+          FX::storeIndex[key] = storeAddress(FX::storeHead, FX::storeOffset);
+          FX::storeOffset += length;
+        }
+      }
+      offset += length;
+    }
+  }
+  markStoreMoved(FX::storeHead);
+  eraseStoreBlock(block);
+}
+
+
+bool FX::beginStore(uint8_t blocks)
+{
+  storeBlocks = 0;
+  if (blocks < 2 || blocks > storeMaxBlocks) return false;
+  storeBlocks = blocks;
+
+  // the head is the valid block with the highest sequence number
+  bool found = false;
+  uint16_t sequence;
+  for (uint8_t block = 0; block < blocks; block++)
+  {
+    if (readStoreHeader(block, sequence) && (!found || (int16_t)(sequence - storeSequence) > 0))
+    {
+      storeHead = block;
+      storeSequence = sequence;
+      found = true;
+    }
+  }
+
+  if (!found)
+  {
+    // new store
+    storeHead = 0;
+    storeSequence = 0;
+    if (!storeBlockErased(0)) eraseStoreBlock(0);
+    writeStoreHeader(0, 0);
+    markStoreMoved(0);
+  }
+
+  uint8_t spare = (storeHead + 1) % blocks;
+  bool moved = storeMoved(storeHead);
+  if (!moved && readStoreHeader(spare, sequence))
+  {
+    // copying the records of the block after the head was cut short. The
+    // head only holds copies of its records: start over
+    eraseStoreBlock(storeHead);
+    writeStoreHeader(storeHead, storeSequence);
+  }
+  else if (moved && !storeBlockErased(spare))
+  {
+    // erasing the block after the head or writing its header was cut short
+    eraseStoreBlock(spare);
+  }
+
+  // index the records from the oldest block to the head, which comes last
+  memset(storeIndex, 0, sizeof(storeIndex));
+  for (uint8_t i = moved ? 2 : 1; i <= blocks; i++)
+  {
+    uint8_t block = (storeHead + i) % blocks;
+    if (readStoreHeader(block, sequence)) storeOffset = indexStoreBlock(block);
+  }
+
+  if (!moved) compactStoreBlock(spare);
+  return true;
+}
+
+
+bool FX::loadRecord(uint8_t key, void* buffer, uint8_t size)
+{
+  if (storeBlocks < 2 || key >= FX_STORE_KEYS || storeIndex[key] == 0) return false;
+  uint8_t recordSize;
+  readSaveBytes(storeIndex[key] + 1, &recordSize, 1);
+  if (size > recordSize) size = recordSize;
+  if (size) readSaveBytes(storeIndex[key] + 2, (uint8_t*)buffer, size);
+  return true;
 }
 
+
+bool FX::saveRecord(uint8_t key, const void* data, uint8_t size)
+{
+  if (storeBlocks < 2 || key >= FX_STORE_KEYS) return false;
+  uint16_t length = recordOverhead + size;
+  if (storeOffset + length > storeBlockSize)
+  {
+    // continue in the erased block and reclaim the oldest block
+    storeHead = (storeHead + 1) % storeBlocks;
+    storeSequence++;
+    writeStoreHeader(storeHead, storeSequence);
+    storeOffset = storeFirstRecord;
+    compactStoreBlock((storeHead + 1) % storeBlocks);
+    if (storeOffset + length > storeBlockSize) return false;
+  }
+  uint8_t header[2] = { key, size };
+  uint16_t crc = crc16(crc16(0xFFFF, key), size);
+  for (uint8_t i = 0; i < size; i++) crc = crc16(crc, ((const uint8_t*)data)[i]);
+  crc = crc16End(crc);
+  uint8_t check[2] = { (uint8_t)(crc >> 8), (uint8_t)crc };
+  programStart(storeAddress(storeHead, storeOffset));
+  programBytes(header, 2);
+  programBytes((const uint8_t*)data, size);
+  programBytes(check, 2);
+  programEnd();
+  storeIndex[key] = storeAddress(storeHead, storeOffset);
+  storeOffset += length;
+  return true;
+}
+
+
 void FX::drawBitmap(int16_t x, int16_t y, uint24_t address, uint8_t frame, uint8_t mode)
 {
   // read bitmap dimensions from flash
@@ -461,7 +979,7 @@ void FX::drawBitmap(int16_t x, int16_t y, uint24_t address, uint8_t frame, uint8
   asm volatile(
     "1: ;render_row:                                \n"
     "   cbi     %[fxport], %[fxbit]                 \n"
-    "   ldi     r24, %[cmd]                         \n" // writeByte(SFC_READ);
+    "   ldi     r24, %[cmd]                         \n" // writeByte(SFC_READ_DATA);
     "   out     %[spdr], r24                        \n"
     "   lds     r24, %[datapage]+0                  \n" // address + programDataPage;
     "   lds     r25, %[datapage]+1                  \n"
@@ -486,6 +1004,12 @@ void FX::drawBitmap(int16_t x, int16_t y, uint24_t address, uint8_t frame, uint8
     "   in      r0, %[spsr]                         \n" // wait();
     "   sbrs    r0, %[spif]                         \n"
     "   rjmp    .-6                                 \n"
+   #ifdef FX_FAST_READ
+    "   out     %[spdr], r1                         \n" // writeByte(0); dummy byte
+    "   in      r0, %[spsr]                         \n" // wait();
+    "   sbrs    r0, %[spif]                         \n"
+    "   rjmp    .-6                                 \n"
+   #endif
     "   out     %[spdr], r1                         \n" // SPDR = 0;
     "                                               \n"
     "   lsl     %[mode]                             \n" // 'clear' mode dbfExtraRow by shifting into carry
@@ -591,7 +1115,7 @@ void FX::drawBitmap(int16_t x, int16_t y, uint24_t address, uint8_t frame, uint8
     
     [fxport]       "I" (_SFR_IO_ADDR(FX_PORT)),
     [fxbit]        "I" (FX_BIT),
-    [cmd]          "I" (SFC_READ),
+    [cmd]          "I" (SFC_READ_DATA),
     [spdr]         "I" (_SFR_IO_ADDR(SPDR)),
     [datapage]     ""  (&programDataPage),
     [spsr]         "I" (_SFR_IO_ADDR(SPSR)),
@@ -662,8 +1186,402 @@ void FX::drawBitmap(int16_t x, int16_t y, uint24_t address, uint8_t frame, uint8
 }
 
 
+// overwrite the screen buffer with a tile read into RAM, clipped to the screen
+static void drawTileBuffer(const uint8_t* tile, int16_t x, int16_t y, uint8_t width, uint8_t pages)
+{
+  uint8_t skipleft = x < 0 ? -x : 0;
+  uint8_t renderwidth = x + width > WIDTH ? WIDTH - x : width;
+  uint8_t yshift = FX::bitShiftLeftUInt8(y);          // shift by multiply
+  uint8_t lowmask = 0xFF * yshift;                    // bits of the first row covered by the tile
+  int8_t displayrow = y >> 3;
+  for (uint8_t page = 0; page < pages; page++, displayrow++, tile += width)
+  {
+    if (displayrow >= HEIGHT / 8) return;
+    if (displayrow < -1) continue;
+    bool drawLow  = displayrow >= 0;
+    bool drawHigh = (yshift != 1) && (displayrow + 1 < HEIGHT / 8);
+    uint8_t* display = Arduboy2Base::sBuffer + displayrow * WIDTH + x;
+    for (uint8_t i = skipleft; i < renderwidth; i++)
+    {
+      uint16_t bitmap = FX::multiplyUInt8(tile[i], yshift);
+      if (drawLow) display[i] = (display[i] & ~lowmask) | (uint8_t)bitmap;
+      if (drawHigh) display[i + WIDTH] = (display[i + WIDTH] & lowmask) | (bitmap >> 8);
+    }
+  }
+}
+
+
+void FX::drawTilemap(int16_t x, int16_t y, uint24_t tilemap, uint16_t mapWidth, uint16_t mapHeight, uint24_t tiles)
+{
+  // read tile dimensions from flash
+  seekData(tiles);
+  uint8_t tileWidth  = readPendingUInt16();
+  uint8_t tilePages  = (readPendingLastUInt16() + 7) >> 3;
+  uint8_t tileSize   = tileWidth * tilePages;
+  if (tileWidth == 0 || tileWidth > 16 || tilePages > 2) return; // tile must fit the tile buffer
+  tiles += 4; // skip width, height
+ #ifdef ARDUBOY_DIRTY_RECT
+  Arduboy2Base::markDirty(0, 0, WIDTH, HEIGHT); // the map covers the whole screen
+ #endif
+
+  // first map column and row on screen (rounded down for negative positions)
+  int16_t firstColumn = (x >= 0) ? x / tileWidth : -((tileWidth - 1 - x) / tileWidth);
+  int16_t firstRow    = y >> 3;
+  if (tilePages == 2) firstRow >>= 1;
+  int16_t tileHeight  = tilePages * 8;
+  int16_t screenLeft  = firstColumn * tileWidth - x;
+
+  uint8_t mapBuffer[WIDTH / 8 + 1]; // map indices of a run of tiles on a row
+  uint8_t tileBuffer[32];           // image of the last tile read
+  int16_t bufferedTile = -1;        // tile in tileBuffer
+  bool streaming = false;           // a read of the tile following bufferedTile is pending
+
+  for (int16_t row = firstRow, sy = row * tileHeight - y; sy < HEIGHT; row++, sy += tileHeight)
+  {
+    if (row < 0 || row >= (int16_t)mapHeight) continue;
+    int16_t column = firstColumn;
+    int16_t sx = screenLeft;
+    if (column < 0)
+    {
+      sx -= column * tileWidth;
+      column = 0;
+    }
+    while (sx < WIDTH && column < (int16_t)mapWidth)
+    {
+      // read as many map indices of the row as fit in the buffer with a single seek
+      uint8_t count = (WIDTH - 1 - sx) / tileWidth + 1;
+      if (count > sizeof(mapBuffer)) count = sizeof(mapBuffer);
+      if (count > mapWidth - column) count = mapWidth - column;
+      if (streaming)
+      {
+        readEnd();
+        streaming = false;
+      }
+      readDataBytes(tilemap + (uint24_t)row * mapWidth + column, mapBuffer, count);
+
+      for (uint8_t i = 0; i < count; i++, sx += tileWidth)
+      {
+        uint8_t tile = mapBuffer[i];
+        if (tile != bufferedTile)
+        {
+          // the next tile in flash continues the pending read, any other needs a seek
+          if (!streaming || tile != bufferedTile + 1)
+          {
+            if (streaming) readEnd();
+            seekData(tiles + multiplyUInt8(tile, tileSize));
+            streaming = true;
+          }
+          readBytes(tileBuffer, tileSize);
+          bufferedTile = tile;
+        }
+        drawTileBuffer(tileBuffer, sx, sy, tileWidth, tilePages);
+      }
+      column += count;
+    }
+  }
+  if (streaming) readEnd();
+}
+
+
+// draw a bitmap frame read into RAM the same way drawBitmap() draws from flash
+static void drawBufferedFrame(int16_t x, int16_t y, const uint8_t* frame, int16_t width, int16_t height, uint8_t mode)
+{
+  // determine render width
+  int16_t skipleft = 0;
+  uint8_t renderwidth;
+  if (x<0)
+  {
+    skipleft = -x;
+    if (width - skipleft < WIDTH) renderwidth = width - skipleft;
+    else renderwidth = WIDTH;
+  }
+  else
+  {
+    if (x + width > WIDTH) renderwidth = WIDTH - x;
+    else renderwidth = width;
+  }
+
+  //determine render height
+  int16_t skiptop;     // pixel to be skipped at the top
+  int8_t renderheight; // in pixels
+  if (y < 0)
+  {
+    skiptop = -y & -8; // optimized -y / 8 * 8
+    if (height - skiptop <= HEIGHT) renderheight = height - skiptop;
+    else renderheight = HEIGHT + (y & 7);
+    skiptop >>= 3;//pixels to displayrows
+  }
+  else
+  {
+    skiptop = 0;
+    if (y + height > HEIGHT) renderheight = HEIGHT - y;
+    else renderheight = height;
+  }
+  uint16_t offset = skiptop * width + skipleft;
+  uint8_t stride = width;
+  uint8_t step = 1;
+  if (mode & dbmMasked)
+  {
+    offset += offset; // double for masked bitmaps
+    stride += stride;
+    step = 2;
+  }
+  frame += offset;
+  int8_t displayrow = (y >> 3) + skiptop;
+  uint8_t* display = Arduboy2Base::sBuffer + displayrow * WIDTH + x + skipleft;
+  uint8_t yshift = FX::bitShiftLeftUInt8(y); //shift by multiply
+  uint8_t lastmask = FX::bitShiftRightMaskUInt8(height); // mask for bottom most pixels
+  do
+  {
+    const uint8_t* data = frame;
+    frame += stride;
+    bool extrarow = (yshift != 1) && (displayrow < (HEIGHT / 8 - 1));
+    uint8_t rowmask = 0xFF;
+    if (renderheight < 8) rowmask = lastmask;
+    for (uint8_t c = 0; c < renderwidth; c++, data += step)
+    {
+      uint8_t bitmapbyte = data[0];
+      if (mode & _BV(dbfReverseBlack)) bitmapbyte ^= 0xFF;
+      uint8_t maskbyte = rowmask;
+      if (mode & _BV(dbfWhiteBlack)) maskbyte = bitmapbyte;
+      if (mode & _BV(dbfBlack)) bitmapbyte = 0;
+      if ((mode & _BV(dbfMasked)) && !(mode & _BV(dbfWhiteBlack))) maskbyte = data[1];
+      uint16_t bitmap = FX::multiplyUInt8(bitmapbyte, yshift);
+      uint16_t mask = FX::multiplyUInt8(maskbyte, yshift);
+      if (displayrow >= 0)
+      {
+        uint8_t pixels = bitmap;
+        uint8_t background = display[c];
+        if ((mode & _BV(dbfInvert)) == 0) pixels ^= background;
+        pixels &= mask;
+        pixels ^= background;
+        display[c] = pixels;
+      }
+      if (extrarow)
+      {
+        uint8_t pixels = bitmap >> 8;
+        uint8_t background = display[c + WIDTH];
+        if ((mode & _BV(dbfInvert)) == 0) pixels ^= background;
+        pixels &= mask >> 8;
+        pixels ^= background;
+        display[c + WIDTH] = pixels;
+      }
+    }
+    display += WIDTH;
+    displayrow ++;
+    renderheight -= 8;
+  } while (renderheight > 0);
+}
+
+
+void FX::beginSprites(FXSprite* buffer, uint8_t size)
+{
+  spriteQueue = buffer;
+  spriteQueueSize = size;
+  spriteCount = 0;
+}
+
+
+bool FX::queueSprite(int16_t x, int16_t y, uint24_t address, uint8_t frame, uint8_t mode)
+{
+  if (x >= WIDTH || y >= HEIGHT) return true; // off screen, nothing to draw
+  if (spriteCount >= spriteQueueSize) return false;
+  FXSprite* sprite = spriteQueue + spriteCount++;
+  sprite->x = x;
+  sprite->y = y;
+  sprite->address = address;
+  sprite->frame = frame;
+  sprite->mode = mode;
+  return true;
+}
+
+
+void FX::drawSprites()
+{
+  FXSprite* sprites = spriteQueue;
+  uint8_t count = spriteCount;
+  spriteCount = 0;
+
+  // sort by bitmap and frame so each header and frame is read once. Insertion
+  // sort keeps the queue order of sprites using the same frame.
+  for (uint8_t i = 1; i < count; i++)
+  {
+    FXSprite sprite = sprites[i];
+    uint8_t j = i;
+    while (j > 0 && (sprites[j - 1].address > sprite.address ||
+                     (sprites[j - 1].address == sprite.address && sprites[j - 1].frame > sprite.frame)))
+    {
+      sprites[j] = sprites[j - 1];
+      j--;
+    }
+    sprites[j] = sprite;
+  }
+
+  uint8_t frameBuffer[FX_SPRITE_BUFFER_SIZE]; // data of the last frame read
+  uint24_t address;
+  int16_t width;
+  int16_t height;
+  bool haveHeader = false;
+  int16_t bufferedFrame = -1;  // frame in frameBuffer, -1 if none
+  uint8_t bufferedMode;        // masked or not masked frame data
+  for (uint8_t i = 0; i < count; i++)
+  {
+    FXSprite* sprite = sprites + i;
+    if (!haveHeader || sprite->address != address)
+    {
+      // read bitmap dimensions once for all sprites using this bitmap
+      address = sprite->address;
+      seekData(address);
+      width  = readPendingUInt16();
+      height = readPendingLastUInt16();
+      haveHeader = true;
+      bufferedFrame = -1;
+    }
+    // skip sprites that are completely off screen
+    int16_t x = sprite->x;
+    int16_t y = sprite->y;
+    if (x + width <= 0 || y + height <= 0) continue;
+   #ifdef ARDUBOY_DIRTY_RECT
+    Arduboy2Base::markDirty(x, y, width, height);
+   #endif
+
+    uint8_t masked = sprite->mode & dbmMasked;
+    uint16_t frameSize = width * ((height + 7) >> 3);
+    if (masked) frameSize += frameSize;
+    if (width > FX_SPRITE_BUFFER_SIZE || height > FX_SPRITE_BUFFER_SIZE * 8 || frameSize > FX_SPRITE_BUFFER_SIZE)
+    {
+      // too large for the frame buffer, read it while drawing
+      drawBitmap(x, y, address, sprite->frame, sprite->mode);
+      continue;
+    }
+    if (sprite->frame != bufferedFrame || masked != bufferedMode)
+    {
+      readDataBytes(address + 4 + multiplyUInt8(sprite->frame, frameSize), frameBuffer, frameSize);
+      bufferedFrame = sprite->frame;
+      bufferedMode = masked;
+    }
+    drawBufferedFrame(x, y, frameBuffer, width, height, sprite->mode);
+  }
+}
+
+
+void FX::displayFrame(uint24_t address, bool overlay, bool clear)
+{
+  // address points to (WIDTH * HEIGHT) / 8 bytes of raw display data in
+  // the same format as the screen buffer (no width and height header).
+  // The OLED must be deselected when this function is called and will be
+  // deselected on return.
+  uint8_t* buffer = Arduboy2Base::sBuffer;
+  uint16_t count = (WIDTH * HEIGHT) / 8;
+ #if defined(OLED_SSD1306_I2C) || (OLED_SSD1306_I2CX) || defined(GU12864_800B) || defined(OLED_SH1106) || defined(LCD_ST7565) || defined(OLED_96X96) || defined(OLED_128X96) || defined(OLED_128X128) || defined(OLED_128X64_ON_96X96) || defined(OLED_128X64_ON_128X96) || defined(OLED_128X64_ON_128X128) || defined(OLED_128X96_ON_128X128) || defined(OLED_96X96_ON_128X128) || defined(OLED_64X128_ON_128X128)
+  // displays that need commands or data conversion during a frame:
+  // read the frame into the screen buffer and paint it from there
+  seekData(address);
+  do
+  {
+    uint8_t b = readPendingUInt8();
+    if (overlay) b |= *buffer;
+    *buffer++ = b;
+  }
+  while (--count);
+  readEnd();
+  enableOLED();
+  Arduboy2Core::resetStartLine();
+  Arduboy2Core::paintScreen(Arduboy2Base::sBuffer, clear);
+  disableOLED();
+ #else
+  // SSD1306 in horizontal addressing mode: stream the frame in a single pass.
+  // Once the read command has been sent both chips are selected. The flash
+  // ignores MOSI while it's sending data, so each SPI transfer writes the
+  // previous flash byte to the display while reading the next one.
+  enableOLED();
+  Arduboy2Core::resetStartLine();
+  #ifdef ARDUBOY_DISPLAY_SYNC
+  Arduboy2Core::parkDisplay();
+  #endif
+  disableOLED();
+  Arduboy2Core::LCDDataMode();
+  seekData(address);
+  wait();       // first byte is read with the display still deselected
+  enableOLED();
+  do
+  {
+    uint8_t b = SPDR;
+    if (overlay) b |= *buffer;
+    if (clear) *buffer = 0;
+    buffer++;
+    SPDR = b;
+    wait();
+  }
+  while (--count);
+  disableOLED();
+  disable();
+  #ifdef ARDUBOY_DISPLAY_SYNC
+  enableOLED();
+  Arduboy2Core::unparkDisplay();
+  disableOLED();
+  #endif
+ #endif
+}
+
+
+#ifdef FX_CACHE_LINES
+void FX::readDataCached(uint24_t address, uint8_t* buffer, size_t length)
+{
+  while (length)
+  {
+    uint24_t lineAddress = address & ~(uint24_t)(FX_CACHE_LINE_SIZE - 1);
+    uint8_t lineOffset = address & (FX_CACHE_LINE_SIZE - 1);
+    FXCacheLine& line = cache[(lineAddress / FX_CACHE_LINE_SIZE) % FX_CACHE_LINES];
+    if (line.tag != lineAddress + 1)
+    {
+      readDataBytes(lineAddress, line.data, FX_CACHE_LINE_SIZE);
+      line.tag = lineAddress + 1;
+      cacheMisses++;
+    }
+    else
+    {
+      cacheHits++;
+    }
+    uint8_t count = FX_CACHE_LINE_SIZE - lineOffset;
+    if (count > length) count = length;
+    memcpy(buffer, line.data + lineOffset, count);
+    buffer += count;
+    address += count;
+    length -= count;
+  }
+}
+
+
+void FX::clearCache()
+{
+  for (uint8_t i = 0; i < FX_CACHE_LINES; i++) cache[i].tag = 0;
+}
+
+
+// read a big endian value of size bytes at element index of an array
+static uint32_t readIndexedCached(uint24_t address, uint8_t index, uint8_t size)
+{
+  uint8_t bytes[4];
+  FX::readDataCached(address + FX::multiplyUInt8(index, size), bytes, size);
+  uint32_t value = 0;
+  for (uint8_t i = 0; i < size; i++) value = (value << 8) | bytes[i];
+  return value;
+}
+#endif
+
+
 void FX::readDataArray(uint24_t address, uint8_t index, uint8_t offset, uint8_t elementSize, uint8_t* buffer, size_t length)
 {
+ #ifdef FX_CACHE_LINES
+  if (length <= FX_CACHE_LINE_SIZE)
+  {
+    // same element address as seekDataArray(), size 0 is 256
+    uint16_t elementOffset = elementSize ? multiplyUInt8(index, elementSize) : (uint16_t)index << 8;
+    readDataCached(address + elementOffset + offset, buffer, length);
+    return;
+  }
+ #endif
   seekDataArray(address, index, offset, elementSize);
   readBytesEnd(buffer, length);
 }
@@ -671,27 +1589,43 @@ void FX::readDataArray(uint24_t address, uint8_t index, uint8_t offset, uint8_t
 
 uint16_t FX::readIndexedUInt8(uint24_t address, uint8_t index)
 {
+ #ifdef FX_CACHE_LINES
+  return readIndexedCached(address, index, sizeof(uint8_t));
+ #else
   seekDataArray(address, index, 0, sizeof(uint8_t));
   return readEnd();
+ #endif
 }
 
 
 uint16_t FX::readIndexedUInt16(uint24_t address, uint8_t index)
 {
+ #ifdef FX_CACHE_LINES
+  return readIndexedCached(address, index, sizeof(uint16_t));
+ #else
   seekDataArray(address, index, 0, sizeof(uint16_t));
   return readPendingLastUInt16();
+ #endif
 }
 
 
 uint24_t FX::readIndexedUInt24(uint24_t address, uint8_t index)
 {
+ #ifdef FX_CACHE_LINES
+  return readIndexedCached(address, index, sizeof(uint24_t));
+ #else
   seekDataArray(address, index, 0, sizeof(uint24_t));
   return readPendingLastUInt24();
+ #endif
 }
 
 
 uint32_t FX::readIndexedUInt32(uint24_t address, uint8_t index)
 {
-  seekDataArray(address, index, 0, sizeof(uint24_t));
+ #ifdef FX_CACHE_LINES
+  return readIndexedCached(address, index, sizeof(uint32_t));
+ #else
+  seekDataArray(address, index, 0, sizeof(uint32_t));
   return readPendingLastUInt32();
+ #endif
 }
@@ -11,6 +11,65 @@
   #define FX_BIT PORTD1
 #endif
 
+/* Uncomment FX_ASYNC_READ (or pass it as a -D compiler option) to add
+ * FX::readAsync() and FX::readAsyncUpdate(), which split a long read of
+ * program data into RAM into short polled bursts the sketch runs when it has
+ * time, such as once per frame. The flash is deselected between bursts, so
+ * the display and other FX functions can be used in between.
+ *
+ * The bytes aren't read from an interrupt: at 8MHz an SPI byte is sent in 16
+ * CPU cycles, less than it takes to enter and leave an interrupt, so an
+ * interrupt driven read costs more CPU time than a polled one and can't
+ * overlap with the sketch on the ATmega32U4.
+ */
+// #define FX_ASYNC_READ
+
+/* Uncomment FX_FAST_READ (or pass it as a -D compiler option) to read with
+ * the Fast Read command (0x0B) instead of the Read command (0x03). Fast Read
+ * sends a dummy byte after the address, so each seek takes one more byte.
+ *
+ * The SPI clock is shared with the display and set by Arduboy2Core::bootSPI()
+ * to CPU clock / 2 (8MHz at 16MHz), the fastest the ATmega32U4 supports.
+ * The Read command of the common flash chips is specified for at least
+ * 33MHz, so only use this for a chip whose Read command is limited to less
+ * than 8MHz. See the flashbenchmark example.
+ */
+// #define FX_FAST_READ
+
+/* Uncomment FX_WRITE_QUEUE (or pass it as a -D compiler option) to add
+ * FX::queueEraseSaveBlock(), FX::queueWriteSavePage() and FX::writeUpdate().
+ * Queued commands are started once per frame, and a queued erase is
+ * suspended whenever the sketch reads from the flash, so saving doesn't stall
+ * the game. Every flash access then checks for a command in progress first.
+ */
+// #define FX_WRITE_QUEUE
+
+/* Uncomment FX_CACHE_LINES (or pass it as a -D compiler option) to keep the
+ * program data read by readIndexedUInt8/16/24/32() and short readDataArray()
+ * reads in a direct mapped cache of FX_CACHE_LINES lines of FX_CACHE_LINE_SIZE
+ * bytes. Values that were read recently are then copied from RAM instead of
+ * sending a read command and address to the flash. Both sizes should be a
+ * power of two. The cache uses FX_CACHE_LINES * (FX_CACHE_LINE_SIZE + 3)
+ * bytes of RAM. See FX::cacheHits and FX::cacheMisses.
+ */
+// #define FX_CACHE_LINES 4
+
+#if defined(FX_CACHE_LINES) && !defined(FX_CACHE_LINE_SIZE)
+  #define FX_CACHE_LINE_SIZE 16
+#endif
+
+/* FX_STORE_KEYS (which may be passed as a -D compiler option) is the number
+ * of keys the record store accepts, from 0 to FX_STORE_KEYS - 1 (at most 255).
+ * The store keeps where the last record of each key is in RAM, so loading a
+ * record doesn't search the flash. This uses FX_STORE_KEYS * 2 bytes of RAM.
+ */
+#ifndef FX_STORE_KEYS
+  #define FX_STORE_KEYS 32
+#endif
+#if FX_STORE_KEYS > 255
+  #error FX_STORE_KEYS can be at most 255, key 255 marks erased flash.
+#endif
+
 
 //progam data and save data pages(set by PC manager tool)
 constexpr uint16_t FX_VECTOR_KEY_VALUE  = 0x9518;        /* RETI instruction used a magic key */
@@ -25,11 +84,29 @@ constexpr uint8_t SFC_READSTATUS1       = 0x05;
 constexpr uint8_t SFC_READSTATUS2       = 0x35;
 constexpr uint8_t SFC_READSTATUS3       = 0x15;
 constexpr uint8_t SFC_READ              = 0x03;
+constexpr uint8_t SFC_FAST_READ         = 0x0B;
 constexpr uint8_t SFC_WRITE_ENABLE      = 0x06;
-constexpr uint8_t SFC_WRITE             = 0x04;
+constexpr uint8_t SFC_WRITE             = 0x02;
 constexpr uint8_t SFC_ERASE             = 0x20;
 constexpr uint8_t SFC_RELEASE_POWERDOWN = 0xAB;
 constexpr uint8_t SFC_POWERDOWN         = 0xB9;
+constexpr uint8_t SFC_ERASE_SUSPEND     = 0x75;
+constexpr uint8_t SFC_ERASE_RESUME      = 0x7A;
+
+#ifdef FX_FAST_READ
+constexpr uint8_t SFC_READ_DATA = SFC_FAST_READ; // read command used by the library
+#else
+constexpr uint8_t SFC_READ_DATA = SFC_READ;      // read command used by the library
+#endif
+
+#ifdef FX_WRITE_QUEUE
+//state of the last erase or program command (FX::writeState)
+constexpr uint8_t wsIdle          = 0; // no command in progress
+constexpr uint8_t wsProgramming   = 1; // page program, flash access waits for it
+constexpr uint8_t wsErasing       = 2; // eraseSaveBlock(), flash access waits for it
+constexpr uint8_t wsErasingQueued = 3; // queued erase, flash access suspends it
+constexpr uint8_t wsSuspended     = 4; // queued erase suspended, writeUpdate() resumes it
+#endif
 
 //drawbitmap bit flags (used by modes below and internally)
 constexpr uint8_t dbfWhiteBlack   = 0; // bitmap is used as mask
@@ -80,6 +157,37 @@ struct FXAddress
   uint8_t  offset;
 };
 
+struct FXSprite // a sprite queued for drawSprites()
+{
+  int16_t  x;
+  int16_t  y;
+  uint24_t address;
+  uint8_t  frame;
+  uint8_t  mode;
+};
+
+#ifdef FX_CACHE_LINES
+struct FXCacheLine // program data kept in RAM by the read cache
+{
+  uint24_t tag; // program data address of data[0] plus 1, 0 when unused
+  uint8_t  data[FX_CACHE_LINE_SIZE];
+};
+#endif
+
+#ifdef FX_WRITE_QUEUE
+struct FXWrite // an erase or program command queued for writeUpdate()
+{
+  uint16_t page;         // save page to program or in the block to erase
+  const uint8_t* buffer; // 256 bytes to program, nullptr to erase the block
+};
+
+constexpr uint8_t FX_WRITE_QUEUE_SIZE = 4; // erase and program commands that can be queued
+#endif
+
+constexpr uint8_t FX_STORE_NO_KEY = 0xFF; // not a valid saveRecord() key, marks erased flash
+
+constexpr uint8_t FX_SPRITE_BUFFER_SIZE = 64; // largest sprite frame in bytes drawSprites() reads into RAM once for all sprites using it
+
 class FX
 {
   public:
@@ -95,6 +203,9 @@ class FX
     
     static inline void enable() __attribute__((always_inline)) // selects external flash memory and allows new commands
     {
+     #ifdef FX_WRITE_QUEUE
+      if (writeState != wsIdle) writeWait(); // the flash only reads when an erase or program command is done or suspended
+     #endif
       FX_PORT  &= ~(1 << FX_BIT);
     };
 
@@ -145,8 +256,16 @@ class FX
 
     static void writeEnable();// Puts flash memory in write mode, required prior to any write command
 
+    static void waitWhileBusy(); // wait until all erase and program commands (and queued ones with FX_WRITE_QUEUE) have completed
+
+   #ifdef FX_WRITE_QUEUE
+    static void writeWait(); // wait for the erase or program command in progress to complete, or suspend a queued erase. Called by enable()
+   #endif
+
     static void seekCommand(uint8_t command, uint24_t address);// Write command and selects flash memory address. Required by any read or write command
 
+    static void seekRead(uint24_t address); // selects absolute flashaddress for reading and starts the first read
+
     static void seekData(uint24_t address); // selects flashaddress of program data area for reading and starts the first read
     
     static void seekDataArray(uint24_t address, uint8_t index, uint8_t offset, uint8_t elementSize);
@@ -193,11 +312,51 @@ class FX
 
     static void readSaveBytes(uint24_t address, uint8_t* buffer, size_t length);
 
+   #ifdef FX_ASYNC_READ
+    static void readAsync(uint24_t address, uint8_t* buffer, size_t length, void (*done)() = nullptr); // start reading program data into buffer with readAsyncUpdate(). Completes a previous readAsync() first
+
+    static void readAsyncUpdate(size_t maxBytes); // read up to maxBytes of the readAsync() in progress. done() is called by the update that reads the last byte
+
+    static inline bool busy() __attribute__((always_inline)) // true while a readAsync() has bytes left to read
+    {
+      return asyncLength != 0;
+    }
+   #endif
+
     static void eraseSaveBlock(uint16_t page);
 
     static void writeSavePage(uint16_t page, uint8_t* buffer);
 
+   #ifdef FX_WRITE_QUEUE
+    static bool queueEraseSaveBlock(uint16_t page); // queue erasing the 4K block holding save page. Returns false when the queue is full
+
+    static bool queueWriteSavePage(uint16_t page, const uint8_t* buffer); // queue programming 256 bytes of buffer to save page. The buffer must stay unchanged until written. Returns false when the queue is full
+
+    static void writeUpdate(); // start the next queued command when the flash is ready and resume a suspended erase. Call once per frame, after display() so the erase runs while waiting for the next frame
+
+    static inline bool writeBusy() __attribute__((always_inline)) // true until all queued commands have completed
+    {
+      return writeState != wsIdle || writeCount != 0;
+    }
+   #endif
+
+    static bool beginStore(uint8_t blocks); // use the first blocks 4K blocks (2 to 16) of the save area as a record store and recover it after a power loss. Returns false for other numbers of blocks
+
+    static bool loadRecord(uint8_t key, void* buffer, uint8_t size); // read up to size bytes of the last record saved with key. Returns false when there's none
+
+    static bool saveRecord(uint8_t key, const void* data, uint8_t size); // append a record for key (0 to FX_STORE_KEYS - 1). Usually one page program, sometimes a block erase to reclaim old records. Returns false when the store is full
+
     static void drawBitmap(int16_t x, int16_t y, uint24_t address, uint8_t frame, uint8_t mode);
+
+    static void drawTilemap(int16_t x, int16_t y, uint24_t tilemap, uint16_t mapWidth, uint16_t mapHeight, uint24_t tiles); // fill the screen with the tilemap part at map pixel position x,y. Tiles up to 16x16 pixels
+
+    static void beginSprites(FXSprite* buffer, uint8_t size); // use buffer to queue up to size sprites for drawSprites()
+
+    static bool queueSprite(int16_t x, int16_t y, uint24_t address, uint8_t frame, uint8_t mode); // queue a sprite with drawBitmap() parameters. Returns false when the queue is full
+
+    static void drawSprites(); // draw and empty the queue. Sprites are drawn grouped by bitmap and frame, not in queue order, so queue overlapping sprites that must stay on top in a later batch
+
+    static void displayFrame(uint24_t address, bool overlay = false, bool clear = false); // display a full screen frame from program data, optionally with the screen buffer or-ed on top
     
     static void readDataArray(uint24_t address, uint8_t index, uint8_t offset, uint8_t elementSize, uint8_t* buffer, size_t length);
     
@@ -208,6 +367,12 @@ class FX
     static uint24_t readIndexedUInt24(uint24_t address, uint8_t index);
     
     static uint32_t readIndexedUInt32(uint24_t address, uint8_t index);
+
+   #ifdef FX_CACHE_LINES
+    static void readDataCached(uint24_t address, uint8_t* buffer, size_t length); // read program data through the cache. Best for reads up to FX_CACHE_LINE_SIZE bytes
+
+    static void clearCache(); // forget all cached data, needed only when the program data area has been changed
+   #endif
     
     static inline uint16_t multiplyUInt8 (uint8_t a, uint8_t b) __attribute__((always_inline))
     {
@@ -320,5 +485,30 @@ class FX
     
     static uint16_t programDataPage; // program read only data area in flash memory
     static uint16_t programSavePage; // program read and write data area in flash memory
+    static FXSprite* spriteQueue;   // sprites queued for drawSprites()
+    static uint8_t spriteQueueSize; // number of sprites that fit the queue
+    static uint8_t spriteCount;     // number of sprites in the queue
+   #ifdef FX_WRITE_QUEUE
+    static uint8_t writeState;     // state of the last erase or program command
+    static FXWrite writeQueue[FX_WRITE_QUEUE_SIZE]; // commands queued for writeUpdate()
+    static uint8_t writeFirst;     // next queued command
+    static uint8_t writeCount;     // number of queued commands
+   #endif
+    static uint8_t storeBlocks;    // blocks used by the record store
+    static uint8_t storeHead;      // block records are appended to
+    static uint16_t storeSequence; // sequence number of the head block
+    static uint16_t storeOffset;   // where the next record goes in the head block
+    static uint16_t storeIndex[FX_STORE_KEYS]; // where the last record of each key is, 0 for none
+   #ifdef FX_CACHE_LINES
+    static FXCacheLine cache[FX_CACHE_LINES]; // lines of the read cache
+    static uint16_t cacheHits;   // cache lines found in RAM by readDataCached(). May be reset by the sketch
+    static uint16_t cacheMisses; // cache lines read from flash by readDataCached(). May be reset by the sketch
+   #endif
+   #ifdef FX_ASYNC_READ
+    static uint24_t asyncAddress;  // program data address of the next byte of readAsync()
+    static uint8_t* asyncBuffer;   // where the next byte of readAsync() goes
+    static size_t asyncLength;     // bytes left to read by readAsync()
+    static void (*asyncDone)();    // called when readAsync() has completed
+   #endif
 };
 #endif